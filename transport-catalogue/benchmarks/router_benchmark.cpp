@@ -0,0 +1,130 @@
+#include "../graph.h"
+#include "../min_plus.h"
+#include "../router.h"
+#include "../thread_pool.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+// Builds a graph shaped like the one TransportRouter::SetUp produces: two vertices per stop
+// joined by a wait edge, and for every bus an edge from each stop to each later stop of the route.
+graph::DirectedWeightedGraph<double> MakeSyntheticCity(size_t stop_count, size_t bus_count, std::mt19937& generator) {
+    constexpr double BUS_WAIT_TIME = 6.0;
+    graph::DirectedWeightedGraph<double> city(stop_count * 2);
+
+    for (size_t stop = 0; stop < stop_count; ++stop) {
+        city.AddEdge({stop * 2, stop * 2 + 1, BUS_WAIT_TIME});
+    }
+
+    std::uniform_int_distribution<size_t> stop_distribution(0, stop_count - 1);
+    std::uniform_int_distribution<size_t> length_distribution(5, 25);
+    std::uniform_real_distribution<double> time_distribution(0.5, 8.0);
+    for (size_t bus = 0; bus < bus_count; ++bus) {
+        std::vector<size_t> stops(length_distribution(generator));
+        for (auto& stop : stops) {
+            stop = stop_distribution(generator);
+        }
+        for (size_t from = 0; from + 1 < stops.size(); ++from) {
+            double time = 0.0;
+            for (size_t to = from + 1; to < stops.size(); ++to) {
+                time += time_distribution(generator);
+                city.AddEdge({stops[from] * 2 + 1, stops[to] * 2, time});
+                city.AddEdge({stops[to] * 2 + 1, stops[from] * 2, time});
+            }
+        }
+    }
+    return city;
+}
+
+using Probes = std::vector<std::pair<graph::VertexId, graph::VertexId>>;
+
+struct Measurement {
+    double seconds = 0.0;
+    std::vector<double> weights;
+};
+
+template <typename Storage>
+Measurement MeasureRouter(graph::DirectedWeightedGraph<double>& city, size_t thread_count, const Probes& probes) {
+    const auto start = std::chrono::steady_clock::now();
+    const graph::Router<double, Storage> router(city, thread_count);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    Measurement measurement;
+    measurement.seconds = elapsed.count();
+    measurement.weights.reserve(probes.size());
+    for (const auto& [from, to] : probes) {
+        const auto route = router.BuildRoute(from, to);
+        measurement.weights.push_back(route ? route->weight : -1.0);
+    }
+    return measurement;
+}
+
+bool IsSameRoutes(const std::vector<double>& lhs, const std::vector<double>& rhs, double tolerance) {
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (std::abs(lhs[i] - rhs[i]) > tolerance * std::max(1.0, std::abs(lhs[i]))) {
+            return false;
+        }
+    }
+    return lhs.size() == rhs.size();
+}
+
+void PrintMeasurement(std::string_view layout_name, size_t thread_count, double seconds, double baseline_seconds) {
+    std::cout << "layout: "sv << std::setw(13) << layout_name
+              << ", threads: "sv << std::setw(3) << thread_count
+              << ", time: "sv << std::fixed << std::setprecision(3) << seconds << " s"sv
+              << ", speedup: "sv << std::setprecision(2) << baseline_seconds / seconds << '\n';
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const size_t stop_count = argc > 1 ? std::stoul(argv[1]) : 5000;
+    const size_t max_thread_count = argc > 2 ? std::stoul(argv[2]) : parallel::GetDefaultThreadCount();
+
+    std::mt19937 generator(42);
+    auto city = MakeSyntheticCity(stop_count, stop_count / 10, generator);
+    std::cout << "stops: "sv << stop_count << ", vertices: "sv << city.GetVertexCount()
+              << ", edges: "sv << city.GetEdgeCount()
+              << ", min-plus kernel: "sv << graph::GetMinPlusKernelName() << '\n';
+
+    std::uniform_int_distribution<graph::VertexId> vertex_distribution(0, city.GetVertexCount() - 1);
+    Probes probes(1000);
+    for (auto& [from, to] : probes) {
+        from = vertex_distribution(generator);
+        to = vertex_distribution(generator);
+    }
+
+    // Thread scaling of the default layout
+    Measurement reference;
+    for (size_t thread_count = 1; thread_count <= max_thread_count; thread_count *= 2) {
+        Measurement measurement = MeasureRouter<graph::FlatRoutesStorage<double>>(city, thread_count, probes);
+        if (reference.weights.empty()) {
+            reference = measurement;
+        } else if (measurement.weights != reference.weights) {
+            std::cerr << "routes built with "sv << thread_count << " threads differ from the single thread ones\n"sv;
+            return EXIT_FAILURE;
+        }
+        PrintMeasurement("flat double"sv, thread_count, measurement.seconds, reference.seconds);
+    }
+
+    // Layouts compared on a single thread
+    const Measurement nested = MeasureRouter<graph::NestedRoutesStorage<double>>(city, 1, probes);
+    const Measurement flat_float = MeasureRouter<graph::FlatRoutesStorage<double, float>>(city, 1, probes);
+    if (nested.weights != reference.weights || !IsSameRoutes(flat_float.weights, reference.weights, 1e-4)) {
+        std::cerr << "routes built with different table layouts differ\n"sv;
+        return EXIT_FAILURE;
+    }
+    PrintMeasurement("nested double"sv, 1, nested.seconds, reference.seconds);
+    PrintMeasurement("flat float"sv, 1, flat_float.seconds, reference.seconds);
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Runs Dijkstra from both ends of the query at once: forward over the outgoing edges from the
+// source and backward over the incoming edges from the target, always extending the side with
+// the smaller queue head. The search stops as soon as the two queue heads sum up to at least the
+// best route seen so far. Needs the incoming index of the graph (EnableIncomingIndex).
+template <typename Weight>
+class BidirectionalDijkstraRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    explicit BidirectionalDijkstraRouter(const Graph& graph);
+
+    using RouteInfo = graph::RouteInfo<Weight>;
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+private:
+    using HeapItem = std::pair<Weight, VertexId>;
+
+    struct SearchScratch {
+        std::vector<Weight> weights;
+        std::vector<EdgeId> prev_edges;
+        std::vector<uint32_t> marks;
+        std::vector<HeapItem> heap;
+        uint32_t epoch = 0;
+
+        void Prepare(size_t vertex_count) {
+            if (marks.size() < vertex_count) {
+                weights.resize(vertex_count);
+                prev_edges.resize(vertex_count);
+                marks.resize(vertex_count, 0);
+            }
+            heap.clear();
+            if (++epoch == 0) {
+                std::fill(marks.begin(), marks.end(), 0);
+                epoch = 1;
+            }
+        }
+
+        bool IsReached(VertexId vertex) const {
+            return marks[vertex] == epoch;
+        }
+
+        void Reach(VertexId vertex, Weight weight, EdgeId prev_edge) {
+            marks[vertex] = epoch;
+            weights[vertex] = weight;
+            prev_edges[vertex] = prev_edge;
+        }
+    };
+
+    struct QueryScratch {
+        SearchScratch forward;
+        SearchScratch backward;
+    };
+
+    static QueryScratch& GetScratch() {
+        thread_local QueryScratch scratch;
+        return scratch;
+    }
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr EdgeId NO_EDGE = static_cast<EdgeId>(-1);
+    const Graph& graph_;
+};
+
+template <typename Weight>
+BidirectionalDijkstraRouter<Weight>::BidirectionalDijkstraRouter(const Graph& graph)
+    : graph_(graph)
+{
+    if (!graph.HasIncomingIndex()) {
+        throw std::invalid_argument("Bidirectional search needs the incoming edges index");
+    }
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename BidirectionalDijkstraRouter<Weight>::RouteInfo> BidirectionalDijkstraRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    QueryScratch& scratch = GetScratch();
+    SearchScratch& forward = scratch.forward;
+    SearchScratch& backward = scratch.backward;
+    forward.Prepare(vertex_count);
+    backward.Prepare(vertex_count);
+
+    const auto heap_compare = std::greater<HeapItem>{};
+    forward.Reach(from, ZERO_WEIGHT, NO_EDGE);
+    forward.heap.push_back({ZERO_WEIGHT, from});
+    backward.Reach(to, ZERO_WEIGHT, NO_EDGE);
+    backward.heap.push_back({ZERO_WEIGHT, to});
+
+    // The best route seen so far always goes through meeting_vertex: it is kept equal to the
+    // minimum of forward + backward weight over the vertices reached from both sides
+    std::optional<Weight> best_weight;
+    VertexId meeting_vertex = from;
+    if (from == to) {
+        best_weight = ZERO_WEIGHT;
+    }
+    const auto relax = [&best_weight, &meeting_vertex, &heap_compare](SearchScratch& search, const SearchScratch& opposite,
+                                                                       VertexId vertex, Weight weight, EdgeId edge_id) {
+        if (search.IsReached(vertex) && !(weight < search.weights[vertex])) {
+            return;
+        }
+        search.Reach(vertex, weight, edge_id);
+        search.heap.push_back({weight, vertex});
+        std::push_heap(search.heap.begin(), search.heap.end(), heap_compare);
+        if (opposite.IsReached(vertex)) {
+            const Weight route_weight = weight + opposite.weights[vertex];
+            if (!best_weight || route_weight < *best_weight) {
+                best_weight = route_weight;
+                meeting_vertex = vertex;
+            }
+        }
+    };
+
+    while (!forward.heap.empty() && !backward.heap.empty()) {
+        if (best_weight && !(forward.heap.front().first + backward.heap.front().first < *best_weight)) {
+            break;
+        }
+
+        const bool is_forward = !heap_compare(forward.heap.front(), backward.heap.front());
+        SearchScratch& search = is_forward ? forward : backward;
+        const SearchScratch& opposite = is_forward ? backward : forward;
+
+        std::pop_heap(search.heap.begin(), search.heap.end(), heap_compare);
+        const auto [weight, vertex] = search.heap.back();
+        search.heap.pop_back();
+        if (search.weights[vertex] < weight) {
+            continue;
+        }
+
+        if (is_forward) {
+            graph_.ForEachOutgoingEdge(vertex, [&](EdgeId edge_id, VertexId edge_to, Weight edge_weight) {
+                relax(search, opposite, edge_to, weight + edge_weight, edge_id);
+            });
+        } else {
+            graph_.ForEachIncomingEdge(vertex, [&](EdgeId edge_id, VertexId edge_from, Weight edge_weight) {
+                relax(search, opposite, edge_from, weight + edge_weight, edge_id);
+            });
+        }
+    }
+
+    if (!best_weight) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> edges;
+    for (EdgeId edge_id = forward.prev_edges[meeting_vertex]; edge_id != NO_EDGE;
+         edge_id = forward.prev_edges[graph_.GetEdge(edge_id).from])
+    {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+    for (EdgeId edge_id = backward.prev_edges[meeting_vertex]; edge_id != NO_EDGE;
+         edge_id = backward.prev_edges[graph_.GetEdge(edge_id).to])
+    {
+        edges.push_back(edge_id);
+    }
+
+    return RouteInfo{*best_weight, std::move(edges)};
+}
+
+}  // namespace graph
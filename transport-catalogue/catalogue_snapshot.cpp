@@ -0,0 +1,362 @@
+#include "catalogue_snapshot.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+
+#include "transport_catalogue.h"
+
+namespace transport_catalogue {
+    using namespace std::string_literals;
+
+    CatalogueSnapshot::CatalogueSnapshot(const TransportCatalogue& tc, const RoadDistances& road_distances,
+                                         const std::optional<SpatialGrid>& spatial_grid)
+        : road_distances_(road_distances) {
+        const size_t stop_count = tc.GetStopCount();
+        const size_t bus_count = tc.GetBusCount();
+
+        stop_coords_.reserve(stop_count);
+        stop_name_offsets_.reserve(stop_count + 1);
+        stop_name_offsets_.push_back(0);
+        for (StopId stop_id = 0; stop_id < stop_count; ++stop_id) {
+            const Stop& stop = tc.GetStop(stop_id);
+            stop_coords_.push_back(stop.coords);
+            stop_names_ += stop.name;
+            stop_name_offsets_.push_back(static_cast<uint32_t>(stop_names_.size()));
+        }
+        spatial_grid_ = spatial_grid ? *spatial_grid : SpatialGrid(stop_coords_);
+
+        is_circular_routes_.reserve(bus_count);
+        bus_name_offsets_.reserve(bus_count + 1);
+        bus_name_offsets_.push_back(0);
+        route_offsets_.reserve(bus_count + 1);
+        route_offsets_.push_back(0);
+        segment_distance_offsets_.reserve(bus_count + 1);
+        segment_distance_offsets_.push_back(0);
+        for (BusId bus_id = 0; bus_id < bus_count; ++bus_id) {
+            const BusRoute& bus = tc.GetBus(bus_id);
+            const std::vector<StopId>& stop_ids = bus.stop_ids;
+            is_circular_routes_.push_back(bus.is_circular_route);
+            bus_names_ += bus.num;
+            bus_name_offsets_.push_back(static_cast<uint32_t>(bus_names_.size()));
+            route_stop_ids_.insert(route_stop_ids_.end(), stop_ids.begin(), stop_ids.end());
+            route_offsets_.push_back(static_cast<uint32_t>(route_stop_ids_.size()));
+
+            for (size_t from = 0, to = 1; to < stop_ids.size(); ++from, ++to) {
+                segment_distances_.push_back(GetDistance(stop_ids[from], stop_ids[to]));
+            }
+            if (!bus.is_circular_route && !stop_ids.empty()) {
+                for (size_t from = stop_ids.size() - 1, to = stop_ids.size() - 2; from > 0; --from, --to) {
+                    segment_distances_.push_back(GetDistance(stop_ids[from], stop_ids[to]));
+                }
+            }
+            segment_distance_offsets_.push_back(static_cast<uint32_t>(segment_distances_.size()));
+        }
+
+        // The arenas are complete, so the views into them stay valid
+        stopname_to_stop_id_.reserve(stop_count);
+        for (StopId stop_id = 0; stop_id < stop_count; ++stop_id) {
+            stopname_to_stop_id_.emplace(GetStopName(stop_id), stop_id);
+        }
+        busname_to_bus_id_.reserve(bus_count);
+        for (BusId bus_id = 0; bus_id < bus_count; ++bus_id) {
+            busname_to_bus_id_.emplace(GetBusName(bus_id), bus_id);
+        }
+
+        // Buses are visited in the order of their names, so the list of every stop comes out sorted.
+        // A bus passing a stop more than once is listed once.
+        std::vector<BusId> bus_ids_by_name(bus_count);
+        std::iota(bus_ids_by_name.begin(), bus_ids_by_name.end(), 0);
+        std::sort(bus_ids_by_name.begin(), bus_ids_by_name.end(), [this](BusId lhs, BusId rhs) {
+            return GetBusName(lhs) < GetBusName(rhs);
+        });
+
+        bus_name_ranks_.resize(bus_count);
+        for (uint32_t rank = 0; rank < bus_count; ++rank) {
+            bus_name_ranks_[bus_ids_by_name[rank]] = rank;
+        }
+
+        constexpr BusId NO_BUS = std::numeric_limits<BusId>::max();
+        std::vector<BusId> last_bus_ids(stop_count, NO_BUS);
+        stop_bus_offsets_.assign(stop_count + 1, 0);
+        for (const BusId bus_id : bus_ids_by_name) {
+            for (const StopId stop_id : GetRouteStopIds(bus_id)) {
+                if (last_bus_ids[stop_id] != bus_id) {
+                    last_bus_ids[stop_id] = bus_id;
+                    ++stop_bus_offsets_[stop_id + 1];
+                }
+            }
+        }
+        for (size_t stop_id = 1; stop_id <= stop_count; ++stop_id) {
+            stop_bus_offsets_[stop_id] += stop_bus_offsets_[stop_id - 1];
+        }
+
+        std::fill(last_bus_ids.begin(), last_bus_ids.end(), NO_BUS);
+        std::vector<uint32_t> positions(stop_bus_offsets_.begin(), stop_bus_offsets_.end() - 1);
+        stop_bus_ids_.resize(stop_bus_offsets_.back());
+        for (const BusId bus_id : bus_ids_by_name) {
+            for (const StopId stop_id : GetRouteStopIds(bus_id)) {
+                if (last_bus_ids[stop_id] != bus_id) {
+                    last_bus_ids[stop_id] = bus_id;
+                    stop_bus_ids_[positions[stop_id]++] = bus_id;
+                }
+            }
+        }
+        stop_bus_names_.reserve(stop_bus_ids_.size());
+        for (const BusId bus_id : stop_bus_ids_) {
+            stop_bus_names_.push_back(GetBusName(bus_id));
+        }
+
+        ComputeBusStats();
+    }
+
+    // The geographic distance is symmetric, so the way back of a linear route reuses the distances of
+    // the way there, summed in the reverse order
+    void CatalogueSnapshot::ComputeBusStats() {
+        constexpr BusId NO_BUS = std::numeric_limits<BusId>::max();
+        std::vector<BusId> last_bus_ids(GetStopCount(), NO_BUS);
+        std::vector<double> direct_distances;
+
+        bus_stats_.resize(GetBusCount());
+        for (BusId bus_id = 0; bus_id < GetBusCount(); ++bus_id) {
+            const StopIdRange route = GetRouteStopIds(bus_id);
+            const size_t stops_count = route.end() - route.begin();
+            if (stops_count == 0) {
+                continue;
+            }
+            const bool is_circular_route = IsCircularRoute(bus_id);
+            BusStats& stats = bus_stats_[bus_id];
+
+            stats.stops_count = is_circular_route ? stops_count : 2 * stops_count - 1;
+            for (const StopId stop_id : route) {
+                if (last_bus_ids[stop_id] != bus_id) {
+                    last_bus_ids[stop_id] = bus_id;
+                    ++stats.unique_stops_count;
+                }
+            }
+
+            for (const double d_route : GetSegmentDistances(bus_id)) {
+                stats.route_length += d_route;
+            }
+
+            direct_distances.clear();
+            for (auto from = route.begin(), to = from + 1; to != route.end(); ++from, ++to) {
+                direct_distances.push_back(ComputeDistance(stop_coords_[*from], stop_coords_[*to]));
+            }
+            double direct_route_length = 0.0;
+            for (const double distance : direct_distances) {
+                direct_route_length += distance;
+            }
+            if (!is_circular_route) {
+                for (auto it = direct_distances.rbegin(); it != direct_distances.rend(); ++it) {
+                    direct_route_length += *it;
+                }
+            }
+
+            stats.route_curvature = stats.route_length / direct_route_length;
+        }
+    }
+
+    size_t CatalogueSnapshot::GetStopCount() const {
+        return stop_coords_.size();
+    }
+
+    size_t CatalogueSnapshot::GetBusCount() const {
+        return is_circular_routes_.size();
+    }
+
+    StopId CatalogueSnapshot::GetStopId(std::string_view stopname) const {
+        const auto it = stopname_to_stop_id_.find(stopname);
+        if (it == stopname_to_stop_id_.end()) {
+            throw std::out_of_range("not found"s);
+        }
+        return it->second;
+    }
+
+    BusId CatalogueSnapshot::GetBusId(std::string_view busnum) const {
+        const auto it = busname_to_bus_id_.find(busnum);
+        if (it == busname_to_bus_id_.end()) {
+            throw std::out_of_range("not found"s);
+        }
+        return it->second;
+    }
+
+    std::string_view CatalogueSnapshot::GetStopName(StopId stop_id) const {
+        const uint32_t end = stop_name_offsets_.at(static_cast<size_t>(stop_id) + 1);
+        return std::string_view(stop_names_).substr(stop_name_offsets_[stop_id], end - stop_name_offsets_[stop_id]);
+    }
+
+    const geo::Coordinates& CatalogueSnapshot::GetStopCoordinates(StopId stop_id) const {
+        return stop_coords_.at(stop_id);
+    }
+
+    CatalogueSnapshot::BusIdRange CatalogueSnapshot::GetStopBusIds(StopId stop_id) const {
+        const uint32_t end = stop_bus_offsets_.at(static_cast<size_t>(stop_id) + 1);
+        return BusIdRange(stop_bus_ids_.begin() + stop_bus_offsets_[stop_id], stop_bus_ids_.begin() + end);
+    }
+
+    CatalogueSnapshot::BusNameRange CatalogueSnapshot::GetStopBusNames(StopId stop_id) const {
+        const uint32_t end = stop_bus_offsets_.at(static_cast<size_t>(stop_id) + 1);
+        return BusNameRange(stop_bus_names_.begin() + stop_bus_offsets_[stop_id], stop_bus_names_.begin() + end);
+    }
+
+    std::string_view CatalogueSnapshot::GetBusName(BusId bus_id) const {
+        const uint32_t end = bus_name_offsets_.at(static_cast<size_t>(bus_id) + 1);
+        return std::string_view(bus_names_).substr(bus_name_offsets_[bus_id], end - bus_name_offsets_[bus_id]);
+    }
+
+    bool CatalogueSnapshot::IsCircularRoute(BusId bus_id) const {
+        return is_circular_routes_.at(bus_id);
+    }
+
+    CatalogueSnapshot::StopIdRange CatalogueSnapshot::GetRouteStopIds(BusId bus_id) const {
+        const uint32_t end = route_offsets_.at(static_cast<size_t>(bus_id) + 1);
+        return StopIdRange(route_stop_ids_.begin() + route_offsets_[bus_id], route_stop_ids_.begin() + end);
+    }
+
+    CatalogueSnapshot::DistanceRange CatalogueSnapshot::GetSegmentDistances(BusId bus_id) const {
+        const uint32_t end = segment_distance_offsets_.at(static_cast<size_t>(bus_id) + 1);
+        return DistanceRange(segment_distances_.begin() + segment_distance_offsets_[bus_id], segment_distances_.begin() + end);
+    }
+
+    double CatalogueSnapshot::GetDistance(StopId from, StopId to) const {
+        const std::optional<double> distance = road_distances_.Find(from, to);
+        if (!distance) {
+            throw std::out_of_range("not found"s);
+        }
+        return *distance;
+    }
+
+    StopInfo CatalogueSnapshot::GetStopInfo(std::string_view stopname) const {
+        return GetStopInfo(GetStopId(stopname));
+    }
+
+    StopInfo CatalogueSnapshot::GetStopInfo(StopId stop_id) const {
+        StopInfo stopinfo;
+        stopinfo.name = GetStopName(stop_id);
+
+        const BusNameRange bus_names = GetStopBusNames(stop_id);
+        stopinfo.buses.assign(bus_names.begin(), bus_names.end());
+
+        return stopinfo;
+    }
+
+    StopInfoView CatalogueSnapshot::GetStopInfoView(std::string_view stopname) const {
+        return GetStopInfoView(GetStopId(stopname));
+    }
+
+    StopInfoView CatalogueSnapshot::GetStopInfoView(StopId stop_id) const {
+        return StopInfoView{ GetStopName(stop_id), GetStopBusNames(stop_id) };
+    }
+
+    BusInfo CatalogueSnapshot::GetBusInfo(std::string_view busnum) const {
+        return GetBusInfo(GetBusId(busnum));
+    }
+
+    BusInfo CatalogueSnapshot::GetBusInfo(BusId bus_id) const {
+        const BusStats& stats = bus_stats_.at(bus_id);
+
+        BusInfo businfo;
+        businfo.num = GetBusName(bus_id);
+        businfo.stops_count = stats.stops_count;
+        businfo.unique_stops_count = stats.unique_stops_count;
+        businfo.route_length = stats.route_length;
+        businfo.route_curvature = stats.route_curvature;
+
+        return businfo;
+    }
+
+    BusExtendedInfo CatalogueSnapshot::GetBusExtendedInfo(BusId bus_id) const {
+        BusExtendedInfo businfo;
+
+        businfo.name = GetBusName(bus_id);
+        businfo.is_circular_route = IsCircularRoute(bus_id);
+
+        const StopIdRange route = GetRouteStopIds(bus_id);
+        businfo.stops_and_coordinates.reserve(route.end() - route.begin());
+        for (const StopId stop_id : route) {
+            businfo.stops_and_coordinates.push_back({std::string(GetStopName(stop_id)), stop_coords_[stop_id]});
+        }
+
+        return businfo;
+    }
+
+    DirectBusesInfo CatalogueSnapshot::GetDirectBuses(std::string_view from_stopname, std::string_view to_stopname) const {
+        return GetDirectBuses(GetStopId(from_stopname), GetStopId(to_stopname));
+    }
+
+    // Both lists are sorted by bus name, so they are merged by the name ranks
+    DirectBusesInfo CatalogueSnapshot::GetDirectBuses(StopId from, StopId to) const {
+        const BusIdRange from_bus_ids = GetStopBusIds(from);
+        const BusIdRange to_bus_ids = GetStopBusIds(to);
+
+        DirectBusesInfo info;
+        info.buses.reserve(std::min(from_bus_ids.end() - from_bus_ids.begin(), to_bus_ids.end() - to_bus_ids.begin()));
+        auto from_it = from_bus_ids.begin();
+        auto to_it = to_bus_ids.begin();
+        while (from_it != from_bus_ids.end() && to_it != to_bus_ids.end()) {
+            const uint32_t from_rank = bus_name_ranks_[*from_it];
+            const uint32_t to_rank = bus_name_ranks_[*to_it];
+            if (from_rank < to_rank) {
+                ++from_it;
+            } else if (to_rank < from_rank) {
+                ++to_it;
+            } else {
+                info.buses.push_back(MakeDirectBusItem(*from_it, from, to));
+                ++from_it;
+                ++to_it;
+            }
+        }
+        return info;
+    }
+
+    // Walks the unrolled route once, remembering the last position of the first stop
+    DirectBusItem CatalogueSnapshot::MakeDirectBusItem(BusId bus_id, StopId from, StopId to) const {
+        const StopIdRange route = GetRouteStopIds(bus_id);
+        const size_t stops_count = route.end() - route.begin();
+        const size_t total_stops_count = IsCircularRoute(bus_id) ? stops_count : 2 * stops_count - 1;
+
+        DirectBusItem item;
+        item.bus = GetBusName(bus_id);
+
+        std::optional<size_t> from_position;
+        for (size_t transparent = 0; transparent < total_stops_count; ++transparent) {
+            const size_t index = (transparent < stops_count) ? transparent : total_stops_count - 1 - transparent;
+            const StopId stop = *(route.begin() + index);
+            if (stop == to && from_position) {
+                const size_t span_count = transparent - *from_position;
+                if (!item.from_before_to || span_count < item.span_count) {
+                    item.from_before_to = true;
+                    item.span_count = span_count;
+                }
+            }
+            if (stop == from) {
+                from_position = transparent;
+            }
+        }
+        return item;
+    }
+
+    const SpatialGrid& CatalogueSnapshot::GetSpatialGrid() const {
+        return spatial_grid_;
+    }
+
+    NearbyStopsInfo CatalogueSnapshot::GetNearestStops(geo::Coordinates point, size_t count) const {
+        return MakeNearbyStopsInfo(spatial_grid_.FindNearestStops(point, count));
+    }
+
+    NearbyStopsInfo CatalogueSnapshot::GetStopsInRadius(geo::Coordinates point, double radius) const {
+        return MakeNearbyStopsInfo(spatial_grid_.FindStopsInRadius(point, radius));
+    }
+
+    NearbyStopsInfo CatalogueSnapshot::MakeNearbyStopsInfo(const std::vector<SpatialGrid::NearbyStop>& nearby_stops) const {
+        NearbyStopsInfo info;
+        info.stops.reserve(nearby_stops.size());
+        for (const auto& [stop_id, distance] : nearby_stops) {
+            info.stops.push_back({ GetStopName(stop_id), distance });
+        }
+        return info;
+    }
+}
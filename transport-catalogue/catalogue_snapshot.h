@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "domain.h"
+#include "geo.h"
+#include "ranges.h"
+#include "road_distances.h"
+#include "spatial_grid.h"
+
+namespace transport_catalogue {
+class TransportCatalogue;
+
+// Read-only copy of the catalogue made by TransportCatalogue::Freeze() once loading is finished.
+// Everything is kept in flat arrays indexed by id: the names in one character arena per kind,
+// the routes and the buses of every stop in CSR form. A snapshot never changes after construction,
+// so any number of threads may query it at once.
+class CatalogueSnapshot {
+public:
+    using StopIdRange = ranges::Range<std::vector<StopId>::const_iterator>;
+    using BusIdRange = ranges::Range<std::vector<BusId>::const_iterator>;
+    using DistanceRange = ranges::Range<std::vector<double>::const_iterator>;
+    using BusNameRange = ranges::Range<std::vector<std::string_view>::const_iterator>;
+
+    // The road distances should be frozen. The spatial grid is built anew unless one restored from the base is given.
+    CatalogueSnapshot(const TransportCatalogue& tc, const RoadDistances& road_distances, const std::optional<SpatialGrid>& spatial_grid);
+    // Name lookups point into the arenas of this very object
+    CatalogueSnapshot(const CatalogueSnapshot&) = delete;
+    CatalogueSnapshot& operator=(const CatalogueSnapshot&) = delete;
+
+    size_t GetStopCount() const;
+    size_t GetBusCount() const;
+    StopId GetStopId(std::string_view stopname) const;
+    BusId GetBusId(std::string_view busnum) const;
+
+    std::string_view GetStopName(StopId stop_id) const;
+    const geo::Coordinates& GetStopCoordinates(StopId stop_id) const;
+    // Buses going through the stop, sorted by name
+    BusIdRange GetStopBusIds(StopId stop_id) const;
+    BusNameRange GetStopBusNames(StopId stop_id) const;
+
+    std::string_view GetBusName(BusId bus_id) const;
+    bool IsCircularRoute(BusId bus_id) const;
+    StopIdRange GetRouteStopIds(BusId bus_id) const;
+    // Road distances of the segments of the unrolled route: a linear route is driven there and back
+    DistanceRange GetSegmentDistances(BusId bus_id) const;
+
+    double GetDistance(StopId from, StopId to) const;
+
+    StopInfo GetStopInfo(std::string_view stopname) const;
+    StopInfo GetStopInfo(StopId stop_id) const;
+    // Neither sorts nor allocates
+    StopInfoView GetStopInfoView(std::string_view stopname) const;
+    StopInfoView GetStopInfoView(StopId stop_id) const;
+    BusInfo GetBusInfo(std::string_view busnum) const;
+    BusInfo GetBusInfo(BusId bus_id) const;
+    BusExtendedInfo GetBusExtendedInfo(BusId bus_id) const;
+
+    // Buses going through both stops: the intersection of their sorted bus lists
+    DirectBusesInfo GetDirectBuses(std::string_view from_stopname, std::string_view to_stopname) const;
+    DirectBusesInfo GetDirectBuses(StopId from, StopId to) const;
+
+    const SpatialGrid& GetSpatialGrid() const;
+    NearbyStopsInfo GetNearestStops(geo::Coordinates point, size_t count) const;
+    NearbyStopsInfo GetStopsInRadius(geo::Coordinates point, double radius) const;
+
+private:
+    std::vector<geo::Coordinates> stop_coords_;
+    std::string stop_names_;
+    std::vector<uint32_t> stop_name_offsets_;
+    std::unordered_map<std::string_view, StopId> stopname_to_stop_id_;
+    std::vector<uint32_t> stop_bus_offsets_;
+    std::vector<BusId> stop_bus_ids_;
+    std::vector<uint32_t> bus_name_ranks_;  // position of every bus in the order of names
+    std::vector<std::string_view> stop_bus_names_;  // alongside stop_bus_ids_
+
+    std::string bus_names_;
+    std::vector<uint32_t> bus_name_offsets_;
+    std::unordered_map<std::string_view, BusId> busname_to_bus_id_;
+    std::vector<uint8_t> is_circular_routes_;
+    std::vector<uint32_t> route_offsets_;
+    std::vector<StopId> route_stop_ids_;
+    std::vector<uint32_t> segment_distance_offsets_;
+    std::vector<double> segment_distances_;
+
+    // Bus statistics never change after loading, so they are computed for all the buses at once
+    struct BusStats {
+        uint32_t stops_count = 0;
+        uint32_t unique_stops_count = 0;
+        double route_length = 0.0;
+        double route_curvature = 1.0;
+    };
+
+    std::vector<BusStats> bus_stats_;
+
+    RoadDistances road_distances_;
+    SpatialGrid spatial_grid_;
+
+    void ComputeBusStats();
+    DirectBusItem MakeDirectBusItem(BusId bus_id, StopId from, StopId to) const;
+    NearbyStopsInfo MakeNearbyStopsInfo(const std::vector<SpatialGrid::NearbyStop>& nearby_stops) const;
+};
+}
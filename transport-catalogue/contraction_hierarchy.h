@@ -0,0 +1,518 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Contraction Hierarchies: vertices are contracted one by one in the order of their importance,
+// and whenever a contracted vertex lies on the only shortest path between two of its neighbours,
+// a shortcut edge replacing the two-edge path is added. A query then runs a Dijkstra from both
+// ends that only goes up the order, so it settles a small fraction of the graph.
+// Arcs [0, edge_count) are the edges of the graph, the following ones are shortcuts, each
+// remembering the two arcs it replaces, so routes unpack into the original edge ids.
+template <typename Weight>
+class ContractionHierarchy {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using ArcId = EdgeId;
+
+    struct Shortcut {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+        ArcId first;
+        ArcId second;
+    };
+
+    // Orders the vertices and contracts the graph
+    explicit ContractionHierarchy(const Graph& graph);
+    // Restores a hierarchy built earlier for the same graph
+    ContractionHierarchy(const Graph& graph, std::vector<uint32_t> ranks, std::vector<Shortcut> shortcuts);
+
+    using RouteInfo = graph::RouteInfo<Weight>;
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    const std::vector<uint32_t>& GetRanks() const {
+        return ranks_;
+    }
+
+    const std::vector<Shortcut>& GetShortcuts() const {
+        return shortcuts_;
+    }
+
+private:
+    static constexpr ArcId NO_ARC = static_cast<ArcId>(-1);
+    static constexpr Weight ZERO_WEIGHT{};
+    // A witness search gives up after settling that many vertices and the shortcut is added anyway.
+    // Estimating a priority only needs a rough shortcut count, so it searches less.
+    static constexpr size_t WITNESS_SETTLED_LIMIT = 500;
+    static constexpr size_t SIMULATION_SETTLED_LIMIT = 50;
+
+    using HeapItem = std::pair<Weight, VertexId>;
+
+    struct SearchArc {
+        VertexId head;
+        Weight weight;
+        ArcId arc;
+    };
+
+    // Upward arcs of the search in CSR form: arcs_[v] occupy [offsets[v], offsets[v + 1])
+    struct SearchGraph {
+        std::vector<size_t> offsets;
+        std::vector<SearchArc> arcs;
+    };
+
+    struct SearchScratch {
+        std::vector<Weight> weights;
+        std::vector<ArcId> prev_arcs;
+        std::vector<uint32_t> marks;
+        std::vector<HeapItem> heap;
+        uint32_t epoch = 0;
+
+        void Prepare(size_t vertex_count) {
+            if (marks.size() < vertex_count) {
+                weights.resize(vertex_count);
+                prev_arcs.resize(vertex_count);
+                marks.resize(vertex_count, 0);
+            }
+            heap.clear();
+            if (++epoch == 0) {
+                std::fill(marks.begin(), marks.end(), 0);
+                epoch = 1;
+            }
+        }
+
+        bool IsReached(VertexId vertex) const {
+            return marks[vertex] == epoch;
+        }
+
+        void Reach(VertexId vertex, Weight weight, ArcId prev_arc) {
+            marks[vertex] = epoch;
+            weights[vertex] = weight;
+            prev_arcs[vertex] = prev_arc;
+        }
+    };
+
+    struct QueryScratch {
+        SearchScratch forward;
+        SearchScratch backward;
+    };
+
+    static QueryScratch& GetScratch() {
+        thread_local QueryScratch scratch;
+        return scratch;
+    }
+
+    // Arcs still incident to uncontracted vertices while the hierarchy is being built
+    struct ContractionState {
+        std::vector<std::vector<ArcId>> outgoing;
+        std::vector<std::vector<ArcId>> incoming;
+        std::vector<bool> is_contracted;
+        std::vector<uint32_t> contracted_neighbours;
+        SearchScratch witness;
+        std::vector<uint32_t> target_marks;  // equal to the witness epoch for targets of the current search
+    };
+
+    size_t vertex_count_;
+    size_t edge_count_;
+    std::vector<Edge<Weight>> arcs_;
+    std::vector<uint32_t> ranks_;
+    std::vector<Shortcut> shortcuts_;
+    SearchGraph forward_graph_;
+    SearchGraph backward_graph_;
+
+    void Contract();
+    int ContractVertex(VertexId vertex, ContractionState& state, bool simulate);
+    void AddShortcut(const Shortcut& shortcut, ContractionState& state);
+    void BuildSearchGraphs();
+    void UnpackArc(ArcId arc, std::vector<EdgeId>& edges) const;
+
+    static std::vector<std::pair<VertexId, ArcId>> GetCheapestArcs(
+        const std::vector<ArcId>& arc_ids, const std::vector<Edge<Weight>>& arcs, bool by_source,
+        VertexId vertex, const std::vector<bool>& is_contracted);
+};
+
+template <typename Weight>
+ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph)
+    : vertex_count_(graph.GetVertexCount())
+    , edge_count_(graph.GetEdgeCount())
+{
+    arcs_.reserve(edge_count_);
+    for (EdgeId edge_id = 0; edge_id < edge_count_; ++edge_id) {
+        const Edge<Weight>& edge = graph.GetEdge(edge_id);
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        arcs_.push_back(edge);
+    }
+    Contract();
+    BuildSearchGraphs();
+}
+
+template <typename Weight>
+ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph, std::vector<uint32_t> ranks, std::vector<Shortcut> shortcuts)
+    : vertex_count_(graph.GetVertexCount())
+    , edge_count_(graph.GetEdgeCount())
+    , ranks_(std::move(ranks))
+    , shortcuts_(std::move(shortcuts))
+{
+    if (ranks_.size() != vertex_count_) {
+        throw std::invalid_argument("Hierarchy doesn't match the graph");
+    }
+    arcs_.reserve(edge_count_ + shortcuts_.size());
+    for (EdgeId edge_id = 0; edge_id < edge_count_; ++edge_id) {
+        arcs_.push_back(graph.GetEdge(edge_id));
+    }
+    for (const Shortcut& shortcut : shortcuts_) {
+        if (shortcut.from >= vertex_count_ || shortcut.to >= vertex_count_
+            || shortcut.first >= arcs_.size() || shortcut.second >= arcs_.size()) {
+            throw std::invalid_argument("Hierarchy doesn't match the graph");
+        }
+        arcs_.push_back({shortcut.from, shortcut.to, shortcut.weight});
+    }
+    BuildSearchGraphs();
+}
+
+// Picks the cheapest arc to (by_source == false) or from (by_source == true) every uncontracted neighbour
+template <typename Weight>
+std::vector<std::pair<VertexId, typename ContractionHierarchy<Weight>::ArcId>> ContractionHierarchy<Weight>::GetCheapestArcs(
+    const std::vector<ArcId>& arc_ids, const std::vector<Edge<Weight>>& arcs, bool by_source,
+    VertexId vertex, const std::vector<bool>& is_contracted)
+{
+    std::vector<std::pair<VertexId, ArcId>> result;
+    result.reserve(arc_ids.size());
+    for (const ArcId arc : arc_ids) {
+        const VertexId neighbour = by_source ? arcs[arc].from : arcs[arc].to;
+        if (neighbour != vertex && !is_contracted[neighbour]) {
+            result.emplace_back(neighbour, arc);
+        }
+    }
+    std::sort(result.begin(), result.end(), [&arcs](const auto& lhs, const auto& rhs) {
+        return lhs.first < rhs.first || (lhs.first == rhs.first && arcs[lhs.second].weight < arcs[rhs.second].weight);
+    });
+    result.erase(std::unique(result.begin(), result.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first == rhs.first;
+    }), result.end());
+    return result;
+}
+
+// Returns the number of shortcuts contracting the vertex needs; adds them unless simulating
+template <typename Weight>
+int ContractionHierarchy<Weight>::ContractVertex(VertexId vertex, ContractionState& state, bool simulate) {
+    const auto incoming = GetCheapestArcs(state.incoming[vertex], arcs_, true, vertex, state.is_contracted);
+    const auto outgoing = GetCheapestArcs(state.outgoing[vertex], arcs_, false, vertex, state.is_contracted);
+
+    // A target entered only through the vertex can't have a witness path, so it needs no search
+    std::vector<bool> is_bypassable(outgoing.size(), false);
+    for (size_t i = 0; i < outgoing.size(); ++i) {
+        for (const ArcId arc : state.incoming[outgoing[i].first]) {
+            if (arcs_[arc].from != vertex && !state.is_contracted[arcs_[arc].from]) {
+                is_bypassable[i] = true;
+                break;
+            }
+        }
+    }
+
+    int shortcut_count = 0;
+    std::vector<Shortcut> shortcuts;
+    for (const auto& [source, in_arc] : incoming) {
+        const Weight in_weight = arcs_[in_arc].weight;
+        Weight max_weight = ZERO_WEIGHT;
+        size_t unsettled_target_count = 0;
+        for (size_t i = 0; i < outgoing.size(); ++i) {
+            if (outgoing[i].first != source && is_bypassable[i]) {
+                max_weight = std::max(max_weight, in_weight + arcs_[outgoing[i].second].weight);
+                ++unsettled_target_count;
+            }
+        }
+
+        // Local Dijkstra from the source avoiding the vertex, bounded by the longest candidate shortcut
+        SearchScratch& witness = state.witness;
+        witness.Prepare(vertex_count_);
+        state.target_marks.resize(vertex_count_, 0);
+        for (size_t i = 0; i < outgoing.size(); ++i) {
+            if (outgoing[i].first != source && is_bypassable[i]) {
+                state.target_marks[outgoing[i].first] = witness.epoch;
+            }
+        }
+        const auto heap_compare = std::greater<HeapItem>{};
+        witness.Reach(source, ZERO_WEIGHT, NO_ARC);
+        witness.heap.push_back({ZERO_WEIGHT, source});
+        size_t settled_count = 0;
+        const size_t settled_limit = simulate ? SIMULATION_SETTLED_LIMIT : WITNESS_SETTLED_LIMIT;
+        while (unsettled_target_count > 0 && !witness.heap.empty() && settled_count < settled_limit) {
+            std::pop_heap(witness.heap.begin(), witness.heap.end(), heap_compare);
+            const auto [weight, current] = witness.heap.back();
+            witness.heap.pop_back();
+            if (witness.weights[current] < weight) {
+                continue;
+            }
+            if (max_weight < weight) {
+                break;
+            }
+            ++settled_count;
+            if (state.target_marks[current] == witness.epoch && --unsettled_target_count == 0) {
+                break;
+            }
+            for (const ArcId arc : state.outgoing[current]) {
+                const VertexId next = arcs_[arc].to;
+                if (next == vertex || state.is_contracted[next]) {
+                    continue;
+                }
+                const Weight candidate_weight = weight + arcs_[arc].weight;
+                if (max_weight < candidate_weight) {
+                    continue;
+                }
+                if (!witness.IsReached(next) || candidate_weight < witness.weights[next]) {
+                    witness.Reach(next, candidate_weight, arc);
+                    witness.heap.push_back({candidate_weight, next});
+                    std::push_heap(witness.heap.begin(), witness.heap.end(), heap_compare);
+                }
+            }
+        }
+
+        for (const auto& [target, out_arc] : outgoing) {
+            if (target == source) {
+                continue;
+            }
+            const Weight shortcut_weight = in_weight + arcs_[out_arc].weight;
+            if (witness.IsReached(target) && !(shortcut_weight < witness.weights[target])) {
+                continue;
+            }
+            ++shortcut_count;
+            if (!simulate) {
+                shortcuts.push_back({source, target, shortcut_weight, in_arc, out_arc});
+            }
+        }
+    }
+
+    for (const Shortcut& shortcut : shortcuts) {
+        AddShortcut(shortcut, state);
+    }
+    return shortcut_count;
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::AddShortcut(const Shortcut& shortcut, ContractionState& state) {
+    const ArcId arc = arcs_.size();
+    arcs_.push_back({shortcut.from, shortcut.to, shortcut.weight});
+    shortcuts_.push_back(shortcut);
+    state.outgoing[shortcut.from].push_back(arc);
+    state.incoming[shortcut.to].push_back(arc);
+}
+
+// Vertices are ordered lazily by the edge difference (shortcuts added minus arcs removed) plus the
+// number of already contracted neighbours, which spreads the contraction evenly over the graph.
+template <typename Weight>
+void ContractionHierarchy<Weight>::Contract() {
+    ContractionState state;
+    state.outgoing.resize(vertex_count_);
+    state.incoming.resize(vertex_count_);
+    state.is_contracted.assign(vertex_count_, false);
+    state.contracted_neighbours.assign(vertex_count_, 0);
+    for (ArcId arc = 0; arc < arcs_.size(); ++arc) {
+        if (arcs_[arc].from != arcs_[arc].to) {
+            state.outgoing[arcs_[arc].from].push_back(arc);
+            state.incoming[arcs_[arc].to].push_back(arc);
+        }
+    }
+
+    const auto get_priority = [this, &state](VertexId vertex) {
+        const int shortcut_count = ContractVertex(vertex, state, true);
+        return shortcut_count - static_cast<int>(state.incoming[vertex].size() + state.outgoing[vertex].size())
+            + static_cast<int>(state.contracted_neighbours[vertex]);
+    };
+
+    using QueueItem = std::pair<int, VertexId>;
+    const auto queue_compare = std::greater<QueueItem>{};
+    std::vector<QueueItem> queue;
+    queue.reserve(vertex_count_);
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+        queue.push_back({get_priority(vertex), vertex});
+    }
+    std::make_heap(queue.begin(), queue.end(), queue_compare);
+
+    ranks_.assign(vertex_count_, 0);
+    uint32_t next_rank = 0;
+    while (!queue.empty()) {
+        std::pop_heap(queue.begin(), queue.end(), queue_compare);
+        const VertexId vertex = queue.back().second;
+        queue.pop_back();
+
+        const int priority = get_priority(vertex);
+        if (!queue.empty() && queue_compare(QueueItem{priority, vertex}, queue.front())) {
+            queue.push_back({priority, vertex});
+            std::push_heap(queue.begin(), queue.end(), queue_compare);
+            continue;
+        }
+
+        ContractVertex(vertex, state, false);
+        state.is_contracted[vertex] = true;
+        ranks_[vertex] = next_rank++;
+
+        const auto drop_contracted = [this, &state](std::vector<ArcId>& arcs) {
+            arcs.erase(std::remove_if(arcs.begin(), arcs.end(), [this, &state](ArcId arc) {
+                return state.is_contracted[arcs_[arc].from] || state.is_contracted[arcs_[arc].to];
+            }), arcs.end());
+        };
+        for (const ArcId arc : state.incoming[vertex]) {
+            const VertexId neighbour = arcs_[arc].from;
+            if (!state.is_contracted[neighbour]) {
+                ++state.contracted_neighbours[neighbour];
+                drop_contracted(state.outgoing[neighbour]);
+            }
+        }
+        for (const ArcId arc : state.outgoing[vertex]) {
+            const VertexId neighbour = arcs_[arc].to;
+            if (!state.is_contracted[neighbour]) {
+                ++state.contracted_neighbours[neighbour];
+                drop_contracted(state.incoming[neighbour]);
+            }
+        }
+        std::vector<ArcId>().swap(state.incoming[vertex]);
+        std::vector<ArcId>().swap(state.outgoing[vertex]);
+    }
+}
+
+// The forward search follows arcs going up the order, the backward search follows arcs coming
+// down the order in reverse, so both graphs are indexed by the vertex the search stands at.
+template <typename Weight>
+void ContractionHierarchy<Weight>::BuildSearchGraphs() {
+    forward_graph_.offsets.assign(vertex_count_ + 1, 0);
+    backward_graph_.offsets.assign(vertex_count_ + 1, 0);
+    for (const Edge<Weight>& arc : arcs_) {
+        if (ranks_[arc.from] < ranks_[arc.to]) {
+            ++forward_graph_.offsets[arc.from + 1];
+        } else if (ranks_[arc.to] < ranks_[arc.from]) {
+            ++backward_graph_.offsets[arc.to + 1];
+        }
+    }
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+        forward_graph_.offsets[vertex + 1] += forward_graph_.offsets[vertex];
+        backward_graph_.offsets[vertex + 1] += backward_graph_.offsets[vertex];
+    }
+
+    forward_graph_.arcs.resize(forward_graph_.offsets.back());
+    backward_graph_.arcs.resize(backward_graph_.offsets.back());
+    std::vector<size_t> forward_positions(forward_graph_.offsets.begin(), forward_graph_.offsets.end() - 1);
+    std::vector<size_t> backward_positions(backward_graph_.offsets.begin(), backward_graph_.offsets.end() - 1);
+    for (ArcId arc_id = 0; arc_id < arcs_.size(); ++arc_id) {
+        const Edge<Weight>& arc = arcs_[arc_id];
+        if (ranks_[arc.from] < ranks_[arc.to]) {
+            forward_graph_.arcs[forward_positions[arc.from]++] = {arc.to, arc.weight, arc_id};
+        } else if (ranks_[arc.to] < ranks_[arc.from]) {
+            backward_graph_.arcs[backward_positions[arc.to]++] = {arc.from, arc.weight, arc_id};
+        }
+    }
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::UnpackArc(ArcId arc, std::vector<EdgeId>& edges) const {
+    std::vector<ArcId> stack{arc};
+    while (!stack.empty()) {
+        const ArcId current = stack.back();
+        stack.pop_back();
+        if (current < edge_count_) {
+            edges.push_back(current);
+        } else {
+            const Shortcut& shortcut = shortcuts_[current - edge_count_];
+            stack.push_back(shortcut.second);
+            stack.push_back(shortcut.first);
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename ContractionHierarchy<Weight>::RouteInfo> ContractionHierarchy<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    if (from >= vertex_count_ || to >= vertex_count_) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    QueryScratch& scratch = GetScratch();
+    scratch.forward.Prepare(vertex_count_);
+    scratch.backward.Prepare(vertex_count_);
+
+    const auto heap_compare = std::greater<HeapItem>{};
+    scratch.forward.Reach(from, ZERO_WEIGHT, NO_ARC);
+    scratch.forward.heap.push_back({ZERO_WEIGHT, from});
+    scratch.backward.Reach(to, ZERO_WEIGHT, NO_ARC);
+    scratch.backward.heap.push_back({ZERO_WEIGHT, to});
+
+    std::optional<Weight> best_weight;
+    VertexId meeting_vertex = 0;
+    while (!scratch.forward.heap.empty() || !scratch.backward.heap.empty()) {
+        const bool is_forward = !scratch.forward.heap.empty()
+            && (scratch.backward.heap.empty() || !heap_compare(scratch.forward.heap.front(), scratch.backward.heap.front()));
+        SearchScratch& search = is_forward ? scratch.forward : scratch.backward;
+        const SearchScratch& opposite = is_forward ? scratch.backward : scratch.forward;
+        const SearchGraph& search_graph = is_forward ? forward_graph_ : backward_graph_;
+
+        std::pop_heap(search.heap.begin(), search.heap.end(), heap_compare);
+        const auto [weight, vertex] = search.heap.back();
+        search.heap.pop_back();
+
+        if (search.weights[vertex] < weight) {
+            continue;
+        }
+        // Nothing settled later in this direction can improve the route
+        if (best_weight && !(weight < *best_weight)) {
+            search.heap.clear();
+            continue;
+        }
+        if (opposite.IsReached(vertex)) {
+            const Weight route_weight = weight + opposite.weights[vertex];
+            if (!best_weight || route_weight < *best_weight) {
+                best_weight = route_weight;
+                meeting_vertex = vertex;
+            }
+        }
+
+        for (size_t i = search_graph.offsets[vertex]; i < search_graph.offsets[vertex + 1]; ++i) {
+            const SearchArc& arc = search_graph.arcs[i];
+            const Weight candidate_weight = weight + arc.weight;
+            if (!search.IsReached(arc.head) || candidate_weight < search.weights[arc.head]) {
+                search.Reach(arc.head, candidate_weight, arc.arc);
+                search.heap.push_back({candidate_weight, arc.head});
+                std::push_heap(search.heap.begin(), search.heap.end(), heap_compare);
+            }
+        }
+    }
+
+    if (!best_weight) {
+        return std::nullopt;
+    }
+
+    std::vector<ArcId> forward_arcs;
+    for (ArcId arc = scratch.forward.prev_arcs[meeting_vertex]; arc != NO_ARC;
+         arc = scratch.forward.prev_arcs[arcs_[arc].from])
+    {
+        forward_arcs.push_back(arc);
+    }
+    std::reverse(forward_arcs.begin(), forward_arcs.end());
+
+    std::vector<EdgeId> edges;
+    for (const ArcId arc : forward_arcs) {
+        UnpackArc(arc, edges);
+    }
+    for (ArcId arc = scratch.backward.prev_arcs[meeting_vertex]; arc != NO_ARC;
+         arc = scratch.backward.prev_arcs[arcs_[arc].to])
+    {
+        UnpackArc(arc, edges);
+    }
+
+    return RouteInfo{*best_weight, std::move(edges)};
+}
+
+}  // namespace graph
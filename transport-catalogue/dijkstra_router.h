@@ -0,0 +1,267 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Answers every query with a single-source Dijkstra instead of keeping a V x V table:
+// construction is O(E), memory is linear in the graph size. Freeze the graph beforehand
+// to scan the adjacency in its CSR form.
+// Given a heuristic, the search becomes A*: vertices are taken in the order of the weight
+// reached plus the heuristic estimate of the rest of the route to the target.
+template <typename Weight>
+class DijkstraRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    // Lower bound of the route weight from the vertex to the target. It must never overestimate,
+    // otherwise the routes found are not the shortest ones.
+    using Heuristic = std::function<Weight(VertexId vertex, VertexId target)>;
+
+    explicit DijkstraRouter(const Graph& graph, Heuristic heuristic = nullptr);
+
+    using RouteInfo = graph::RouteInfo<Weight>;
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    // A vertex a route may start or end at, with the weight of getting to it or away from it
+    struct Endpoint {
+        VertexId vertex;
+        Weight weight;
+    };
+
+    struct EndpointsRouteInfo {
+        Weight weight;  // the weights of both endpoints included
+        VertexId source;
+        VertexId target;
+        std::vector<EdgeId> edges;
+    };
+
+    // The best route from any of the sources to any of the targets found by one search seeded with
+    // all the sources. The search stops once no vertex left can improve the best total. The heuristic is not used.
+    std::optional<EndpointsRouteInfo> BuildRoute(const std::vector<Endpoint>& sources, const std::vector<Endpoint>& targets) const;
+
+private:
+    using HeapItem = std::pair<Weight, VertexId>;
+
+    // Per-thread buffers reused between queries. A vertex is considered reached in the current
+    // search only if its mark equals the current epoch, so nothing has to be cleared between queries.
+    struct SearchScratch {
+        std::vector<Weight> weights;
+        std::vector<EdgeId> prev_edges;
+        std::vector<Weight> estimates;
+        std::vector<uint32_t> marks;
+        std::vector<uint32_t> target_marks;  // by epoch as well, the target weights are kept in estimates
+        std::vector<HeapItem> heap;
+        uint32_t epoch = 0;
+
+        void Prepare(size_t vertex_count) {
+            if (marks.size() < vertex_count) {
+                weights.resize(vertex_count);
+                prev_edges.resize(vertex_count);
+                estimates.resize(vertex_count);
+                marks.resize(vertex_count, 0);
+                target_marks.resize(vertex_count, 0);
+            }
+            heap.clear();
+            if (++epoch == 0) {
+                std::fill(marks.begin(), marks.end(), 0);
+                std::fill(target_marks.begin(), target_marks.end(), 0);
+                epoch = 1;
+            }
+        }
+
+        bool IsReached(VertexId vertex) const {
+            return marks[vertex] == epoch;
+        }
+
+        void Reach(VertexId vertex, Weight weight, EdgeId prev_edge) {
+            marks[vertex] = epoch;
+            weights[vertex] = weight;
+            prev_edges[vertex] = prev_edge;
+        }
+    };
+
+    static SearchScratch& GetScratch() {
+        thread_local SearchScratch scratch;
+        return scratch;
+    }
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr EdgeId NO_EDGE = static_cast<EdgeId>(-1);
+    const Graph& graph_;
+    Heuristic heuristic_;
+};
+
+template <typename Weight>
+DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph, Heuristic heuristic)
+    : graph_(graph)
+    , heuristic_(std::move(heuristic))
+{
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    SearchScratch& scratch = GetScratch();
+    scratch.Prepare(vertex_count);
+
+    // Heap items are keyed by the weight plus the estimate, the estimate of a vertex is computed once per query.
+    // A vertex is pushed again whenever its weight improves, so an estimate that is admissible but not
+    // consistent still gives the shortest route.
+    const auto heap_compare = std::greater<HeapItem>{};
+    const auto estimate = [this, &scratch, to](VertexId vertex, bool is_reached) {
+        if (!heuristic_) {
+            return ZERO_WEIGHT;
+        }
+        if (!is_reached) {
+            scratch.estimates[vertex] = heuristic_(vertex, to);
+        }
+        return scratch.estimates[vertex];
+    };
+    scratch.Reach(from, ZERO_WEIGHT, NO_EDGE);
+    scratch.heap.push_back({estimate(from, false), from});
+
+    while (!scratch.heap.empty()) {
+        std::pop_heap(scratch.heap.begin(), scratch.heap.end(), heap_compare);
+        const auto [key, vertex] = scratch.heap.back();
+        scratch.heap.pop_back();
+
+        const Weight weight = scratch.weights[vertex];
+        if (weight + estimate(vertex, true) < key) {
+            continue;
+        }
+        if (vertex == to) {
+            break;
+        }
+
+        graph_.ForEachOutgoingEdge(vertex, [&scratch, &heap_compare, &estimate, weight](EdgeId edge_id, VertexId edge_to, Weight edge_weight) {
+            const Weight candidate_weight = weight + edge_weight;
+            const bool is_reached = scratch.IsReached(edge_to);
+            if (!is_reached || candidate_weight < scratch.weights[edge_to]) {
+                const Weight candidate_key = candidate_weight + estimate(edge_to, is_reached);
+                scratch.Reach(edge_to, candidate_weight, edge_id);
+                scratch.heap.push_back({candidate_key, edge_to});
+                std::push_heap(scratch.heap.begin(), scratch.heap.end(), heap_compare);
+            }
+        });
+    }
+
+    if (!scratch.IsReached(to)) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> edges;
+    for (EdgeId edge_id = scratch.prev_edges[to]; edge_id != NO_EDGE;
+         edge_id = scratch.prev_edges[graph_.GetEdge(edge_id).from])
+    {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{scratch.weights[to], std::move(edges)};
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::EndpointsRouteInfo> DijkstraRouter<Weight>::BuildRoute(
+    const std::vector<Endpoint>& sources, const std::vector<Endpoint>& targets) const
+{
+    const size_t vertex_count = graph_.GetVertexCount();
+    for (const auto& endpoints : {&sources, &targets}) {
+        for (const Endpoint& endpoint : *endpoints) {
+            if (endpoint.vertex >= vertex_count) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            if (endpoint.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Endpoints' weights should be non-negative");
+            }
+        }
+    }
+
+    SearchScratch& scratch = GetScratch();
+    scratch.Prepare(vertex_count);
+
+    for (const auto& [vertex, weight] : targets) {
+        if (scratch.target_marks[vertex] != scratch.epoch || weight < scratch.estimates[vertex]) {
+            scratch.target_marks[vertex] = scratch.epoch;
+            scratch.estimates[vertex] = weight;
+        }
+    }
+
+    const auto heap_compare = std::greater<HeapItem>{};
+    for (const auto& [vertex, weight] : sources) {
+        if (!scratch.IsReached(vertex) || weight < scratch.weights[vertex]) {
+            scratch.Reach(vertex, weight, NO_EDGE);
+            scratch.heap.push_back({weight, vertex});
+            std::push_heap(scratch.heap.begin(), scratch.heap.end(), heap_compare);
+        }
+    }
+
+    // Target weights are non-negative, so a vertex taken at the best total or later can't improve it
+    std::optional<Weight> best_weight;
+    VertexId best_target = 0;
+    while (!scratch.heap.empty()) {
+        std::pop_heap(scratch.heap.begin(), scratch.heap.end(), heap_compare);
+        const auto [key, vertex] = scratch.heap.back();
+        scratch.heap.pop_back();
+
+        const Weight weight = scratch.weights[vertex];
+        if (weight < key) {
+            continue;
+        }
+        if (best_weight && !(weight < *best_weight)) {
+            break;
+        }
+        if (scratch.target_marks[vertex] == scratch.epoch) {
+            const Weight total_weight = weight + scratch.estimates[vertex];
+            if (!best_weight || total_weight < *best_weight) {
+                best_weight = total_weight;
+                best_target = vertex;
+            }
+        }
+
+        graph_.ForEachOutgoingEdge(vertex, [&scratch, &heap_compare, weight](EdgeId edge_id, VertexId edge_to, Weight edge_weight) {
+            const Weight candidate_weight = weight + edge_weight;
+            if (!scratch.IsReached(edge_to) || candidate_weight < scratch.weights[edge_to]) {
+                scratch.Reach(edge_to, candidate_weight, edge_id);
+                scratch.heap.push_back({candidate_weight, edge_to});
+                std::push_heap(scratch.heap.begin(), scratch.heap.end(), heap_compare);
+            }
+        });
+    }
+
+    if (!best_weight) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> edges;
+    VertexId source = best_target;
+    for (EdgeId edge_id = scratch.prev_edges[best_target]; edge_id != NO_EDGE; edge_id = scratch.prev_edges[source]) {
+        edges.push_back(edge_id);
+        source = graph_.GetEdge(edge_id).from;
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return EndpointsRouteInfo{*best_weight, source, best_target, std::move(edges)};
+}
+
+}  // namespace graph
@@ -1,10 +1,13 @@
 #pragma once
 
 #include "geo.h"
+#include "ranges.h"
 
+#include <cstdint>
 #include <vector>
 #include <map>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <optional>
 
@@ -18,7 +21,11 @@ namespace transport_catalogue {
         FindBus,
         GetBusInfo,
         GetMap,
-        GetRoute
+        GetRoute,
+        GetDirectBuses,
+        GetNearestStops,
+        GetStopsInRadius,
+        GetRouteByCoordinates
     };
 
     struct Stop {
@@ -33,11 +40,28 @@ namespace transport_catalogue {
         std::vector<std::string> stopnames;
     };
 
+    // Dense ids the catalogue gives to stops and buses in the order they appear
+    using StopId = uint32_t;
+    using BusId = uint32_t;
+
+    // A bus as the catalogue keeps it, with the route referring to stops by id
+    struct BusRoute {
+        bool is_circular_route = false;
+        std::string num;
+        std::vector<StopId> stop_ids;
+    };
+
     struct StopInfo {
         std::string name;
         std::vector<std::string> buses;
     };
 
+    // The same without copies: the views point into the frozen catalogue and live as long as its snapshot
+    struct StopInfoView {
+        std::string_view name;
+        ranges::Range<std::vector<std::string_view>::const_iterator> buses;
+    };
+
     struct BusInfo {
         std::string num;
         int stops_count = 0;
@@ -46,15 +70,56 @@ namespace transport_catalogue {
         double route_curvature = 1.0;
     };
 
+    // A bus going through both stops of a direct connection request. If the bus, as it is driven, reaches
+    // the second stop after the first one, span_count is the least number of rides between them.
+    struct DirectBusItem {
+        std::string_view bus;
+        bool from_before_to = false;
+        size_t span_count = 0;
+    };
+
+    struct DirectBusesInfo {
+        std::vector<DirectBusItem> buses;  // sorted by name
+    };
+
+    // Point of a nearby stops request, with the number of stops to find or the search radius in meters
+    struct NearbyStopsQuery {
+        geo::Coordinates point;
+        size_t count = 0;
+        double radius = 0.0;
+    };
+
+    struct CoordinatesRouteQuery {
+        geo::Coordinates from;
+        geo::Coordinates to;
+    };
+
+    struct NearbyStopItem {
+        std::string_view name;
+        double distance;
+    };
+
+    struct NearbyStopsInfo {
+        std::vector<NearbyStopItem> stops;  // sorted by distance
+    };
+
     struct BusExtendedInfo {
         bool is_circular_route = false;
         std::string name;
         std::vector<std::tuple<std::string, geo::Coordinates>> stops_and_coordinates;
     };
 
+    enum class RouterEngine { AllPairs, Dijkstra, Raptor, ContractionHierarchy, BidirectionalDijkstra, AStar, Alt, HubLabels };
+    enum class GraphModel { StopPairs, BusLines };
+
     struct RoutingSettings {
         double bus_velocity;
         int bus_wait_time;
+        RouterEngine router_engine = RouterEngine::AllPairs;
+        GraphModel graph_model = GraphModel::StopPairs;
+        double walking_velocity = 5.0;  // km/h
+        double walking_radius = 1000.0;  // meters a route between two points may walk to or from a stop
+        double walking_transfer_radius = 0.0;  // meters between stops joined by walking transfer edges, none if zero
     };
 
     enum class RouteItemType { Wait, Stop };
@@ -70,7 +135,15 @@ namespace transport_catalogue {
         double time;
     };
     
-    using RouteItem = std::variant<std::monostate, WaitItem, BusItem>;
+    // Walk from the start point of a route to a stop or from a stop to the end point, or straight between the points
+    // with no stop name
+    struct WalkItem {
+        std::string stop_name;
+        double distance;
+        double time;
+    };
+
+    using RouteItem = std::variant<std::monostate, WaitItem, BusItem, WalkItem>;
 
     struct RouteInfo {
         double total_time;
@@ -78,8 +151,8 @@ namespace transport_catalogue {
     };
 
         
-    using StatRequestBodyDTO = std::variant<std::monostate,std::string_view,std::tuple<std::string_view,std::string_view>>;
-    using StatResponseBodyDTO = std::variant<std::monostate, std::string, BusInfo, StopInfo, RouteInfo>;
+    using StatRequestBodyDTO = std::variant<std::monostate,std::string_view,std::tuple<std::string_view,std::string_view>,NearbyStopsQuery,CoordinatesRouteQuery>;
+    using StatResponseBodyDTO = std::variant<std::monostate, std::string, BusInfo, StopInfoView, RouteInfo, DirectBusesInfo, NearbyStopsInfo>;
 
     using BaseRequestDTO = std::optional<std::variant<std::monostate, Bus, Stop>>;
     using StatRequestDTO = std::optional<std::tuple<int,RequestType,std::optional<StatRequestBodyDTO>>>;
@@ -3,6 +3,7 @@
 #include "ranges.h"
 
 #include <cstdlib>
+#include <stdexcept>
 #include <vector>
 
 namespace graph {
@@ -17,6 +18,16 @@ struct Edge {
     Weight weight;
 };
 
+// Compressed sparse row form of the outgoing edges: the edges of a vertex v occupy positions
+// [offsets[v], offsets[v + 1]) of the other arrays, ordered by edge id.
+template <typename Weight>
+struct CompressedAdjacency {
+    std::vector<size_t> offsets;
+    std::vector<VertexId> targets;
+    std::vector<Weight> weights;
+    std::vector<EdgeId> edge_ids;
+};
+
 template <typename Weight>
 class DirectedWeightedGraph {
 private:
@@ -34,32 +45,77 @@ public:
     const Edge<Weight>& GetEdge(EdgeId edge_id) const;
     IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
 
+    // Starts keeping the incoming edges of every vertex as well; they are maintained by later AddEdge calls
+    void EnableIncomingIndex();
+    bool HasIncomingIndex() const;
+    IncidentEdgesRange GetIncomingEdges(VertexId vertex) const;
+
+    // Builds the CSR form of the graph (of the incoming edges too, if indexed) and releases the incidence lists,
+    // so the frozen graph keeps its adjacency only once. Any later modification drops the CSR form and rebuilds
+    // the lists from the edges.
+    void Freeze();
+    bool IsFrozen() const;
+    const CompressedAdjacency<Weight>& GetCompressedAdjacency() const;
+    // Here targets hold the sources of the incoming edges
+    const CompressedAdjacency<Weight>& GetCompressedIncomingAdjacency() const;
+
+    // Calls func(edge_id, to, weight) for every outgoing edge of the vertex, reading the CSR arrays when frozen
+    template <typename Func>
+    void ForEachOutgoingEdge(VertexId vertex, Func&& func) const;
+
+    // Calls func(edge_id, from, weight) for every incoming edge of the vertex; requires the incoming index
+    template <typename Func>
+    void ForEachIncomingEdge(VertexId vertex, Func&& func) const;
+
 private:
     std::vector<Edge<Weight>> edges_;
+    size_t vertex_count_ = 0;
     std::vector<IncidenceList> incidence_lists_;
+    bool has_incoming_index_ = false;
+    std::vector<IncidenceList> incoming_incidence_lists_;
+    bool is_frozen_ = false;
+    CompressedAdjacency<Weight> adjacency_;
+    CompressedAdjacency<Weight> incoming_adjacency_;
+
+    template <typename GetVertex, typename GetOtherVertex>
+    void BuildCompressedAdjacency(CompressedAdjacency<Weight>& adjacency, GetVertex get_vertex, GetOtherVertex get_other_vertex) const;
+
+    IncidentEdgesRange GetCompressedEdges(const CompressedAdjacency<Weight>& adjacency, VertexId vertex) const;
+    void BuildIncidenceLists();
+    void Unfreeze();
 };
 
 template <typename Weight>
 DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
-    : incidence_lists_(vertex_count) {
+    : vertex_count_(vertex_count)
+    , incidence_lists_(vertex_count) {
 }
 
 template <typename Weight>
 void DirectedWeightedGraph<Weight>::SetVertexCount(size_t vertex_count) {
+    Unfreeze();
+    vertex_count_ = vertex_count;
     incidence_lists_.resize(vertex_count);
+    if (has_incoming_index_) {
+        incoming_incidence_lists_.resize(vertex_count);
+    }
 }
 
 template <typename Weight>
 EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
+    Unfreeze();
     edges_.push_back(edge);
     const EdgeId id = edges_.size() - 1;
     incidence_lists_.at(edge.from).push_back(id);
+    if (has_incoming_index_) {
+        incoming_incidence_lists_.at(edge.to).push_back(id);
+    }
     return id;
 }
 
 template <typename Weight>
 size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-    return incidence_lists_.size();
+    return vertex_count_;
 }
 
 template <typename Weight>
@@ -75,6 +131,162 @@ const Edge<Weight>& DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const
 template <typename Weight>
 typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
 DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
+    if (is_frozen_) {
+        return GetCompressedEdges(adjacency_, vertex);
+    }
     return ranges::AsRange(incidence_lists_.at(vertex));
 }
-}  // namespace graph
\ No newline at end of file
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::EnableIncomingIndex() {
+    if (has_incoming_index_) {
+        return;
+    }
+    Unfreeze();
+    incoming_incidence_lists_.assign(vertex_count_, {});
+    for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+        incoming_incidence_lists_[edges_[edge_id].to].push_back(edge_id);
+    }
+    has_incoming_index_ = true;
+}
+
+template <typename Weight>
+bool DirectedWeightedGraph<Weight>::HasIncomingIndex() const {
+    return has_incoming_index_;
+}
+
+template <typename Weight>
+typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
+DirectedWeightedGraph<Weight>::GetIncomingEdges(VertexId vertex) const {
+    if (!has_incoming_index_) {
+        throw std::logic_error("Incoming edges are not indexed");
+    }
+    if (is_frozen_) {
+        return GetCompressedEdges(incoming_adjacency_, vertex);
+    }
+    return ranges::AsRange(incoming_incidence_lists_.at(vertex));
+}
+
+template <typename Weight>
+template <typename GetVertex, typename GetOtherVertex>
+void DirectedWeightedGraph<Weight>::BuildCompressedAdjacency(CompressedAdjacency<Weight>& adjacency,
+                                                             GetVertex get_vertex, GetOtherVertex get_other_vertex) const {
+    const size_t vertex_count = vertex_count_;
+    adjacency.offsets.assign(vertex_count + 1, 0);
+    for (const auto& edge : edges_) {
+        ++adjacency.offsets[get_vertex(edge) + 1];
+    }
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        adjacency.offsets[vertex + 1] += adjacency.offsets[vertex];
+    }
+
+    adjacency.targets.resize(edges_.size());
+    adjacency.weights.resize(edges_.size());
+    adjacency.edge_ids.resize(edges_.size());
+    std::vector<size_t> positions(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+        const auto& edge = edges_[edge_id];
+        const size_t position = positions[get_vertex(edge)]++;
+        adjacency.targets[position] = get_other_vertex(edge);
+        adjacency.weights[position] = edge.weight;
+        adjacency.edge_ids[position] = edge_id;
+    }
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::Freeze() {
+    if (is_frozen_) {
+        return;
+    }
+    const auto get_from = [](const Edge<Weight>& edge) { return edge.from; };
+    const auto get_to = [](const Edge<Weight>& edge) { return edge.to; };
+    BuildCompressedAdjacency(adjacency_, get_from, get_to);
+    if (has_incoming_index_) {
+        BuildCompressedAdjacency(incoming_adjacency_, get_to, get_from);
+    }
+    std::vector<IncidenceList>().swap(incidence_lists_);
+    std::vector<IncidenceList>().swap(incoming_incidence_lists_);
+    is_frozen_ = true;
+}
+
+template <typename Weight>
+bool DirectedWeightedGraph<Weight>::IsFrozen() const {
+    return is_frozen_;
+}
+
+template <typename Weight>
+const CompressedAdjacency<Weight>& DirectedWeightedGraph<Weight>::GetCompressedAdjacency() const {
+    return adjacency_;
+}
+
+template <typename Weight>
+const CompressedAdjacency<Weight>& DirectedWeightedGraph<Weight>::GetCompressedIncomingAdjacency() const {
+    return incoming_adjacency_;
+}
+
+// The CSR edges of a vertex are ordered by edge id, just as its incidence list was
+template <typename Weight>
+typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
+DirectedWeightedGraph<Weight>::GetCompressedEdges(const CompressedAdjacency<Weight>& adjacency, VertexId vertex) const {
+    if (vertex >= vertex_count_) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    return {adjacency.edge_ids.begin() + adjacency.offsets[vertex], adjacency.edge_ids.begin() + adjacency.offsets[vertex + 1]};
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::BuildIncidenceLists() {
+    incidence_lists_.assign(vertex_count_, {});
+    if (has_incoming_index_) {
+        incoming_incidence_lists_.assign(vertex_count_, {});
+    }
+    for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+        incidence_lists_[edges_[edge_id].from].push_back(edge_id);
+        if (has_incoming_index_) {
+            incoming_incidence_lists_[edges_[edge_id].to].push_back(edge_id);
+        }
+    }
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::Unfreeze() {
+    if (is_frozen_) {
+        adjacency_ = {};
+        incoming_adjacency_ = {};
+        BuildIncidenceLists();
+        is_frozen_ = false;
+    }
+}
+
+template <typename Weight>
+template <typename Func>
+void DirectedWeightedGraph<Weight>::ForEachOutgoingEdge(VertexId vertex, Func&& func) const {
+    if (is_frozen_) {
+        const size_t end = adjacency_.offsets[vertex + 1];
+        for (size_t position = adjacency_.offsets[vertex]; position < end; ++position) {
+            func(adjacency_.edge_ids[position], adjacency_.targets[position], adjacency_.weights[position]);
+        }
+    } else {
+        for (const EdgeId edge_id : incidence_lists_[vertex]) {
+            const auto& edge = edges_[edge_id];
+            func(edge_id, edge.to, edge.weight);
+        }
+    }
+}
+
+template <typename Weight>
+template <typename Func>
+void DirectedWeightedGraph<Weight>::ForEachIncomingEdge(VertexId vertex, Func&& func) const {
+    if (is_frozen_ && has_incoming_index_) {
+        const size_t end = incoming_adjacency_.offsets[vertex + 1];
+        for (size_t position = incoming_adjacency_.offsets[vertex]; position < end; ++position) {
+            func(incoming_adjacency_.edge_ids[position], incoming_adjacency_.targets[position], incoming_adjacency_.weights[position]);
+        }
+    } else {
+        for (const EdgeId edge_id : GetIncomingEdges(vertex)) {
+            const auto& edge = edges_[edge_id];
+            func(edge_id, edge.from, edge.weight);
+        }
+    }
+}
+}  // namespace graph
@@ -0,0 +1,289 @@
+#pragma once
+
+#include "contraction_hierarchy.h"
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// 2-hop labeling built by pruned landmark labeling. Every vertex v keeps an outgoing label (hubs h
+// with the weight of v -> h) and an incoming label (hubs h with the weight of h -> v), such that
+// some shortest route u -> w passes a hub present in both the outgoing label of u and the incoming
+// label of w. A query is a merge of two arrays sorted by hub. Every entry also keeps the edge that
+// continues the route towards the hub (outgoing) or comes from it (incoming), which lets routes
+// unpack hub by hub into edge ids. Labels of all vertices are stored in one contiguous array per
+// direction, CSR-style. Building needs the incoming index of the graph (EnableIncomingIndex).
+template <typename Weight>
+class HubLabels {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    static constexpr uint32_t NO_EDGE = std::numeric_limits<uint32_t>::max();
+
+    struct LabelEntry {
+        uint32_t hub;  // rank of the hub vertex
+        uint32_t via_edge;
+        Weight weight;
+    };
+
+    // Labels of vertex v occupy [offsets[v], offsets[v + 1]) of entries, ordered by hub.
+    // Both arrays are of fixed width, so the base stores them as they are in memory.
+    struct LabelSet {
+        std::vector<uint64_t> offsets;
+        std::vector<LabelEntry> entries;
+    };
+
+    explicit HubLabels(const Graph& graph);
+    // Restores labels built earlier for the same graph
+    HubLabels(const Graph& graph, std::vector<VertexId> vertices_by_rank, LabelSet outgoing_labels, LabelSet incoming_labels);
+
+    using RouteInfo = graph::RouteInfo<Weight>;
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    const std::vector<VertexId>& GetVerticesByRank() const {
+        return vertices_by_rank_;
+    }
+
+    const LabelSet& GetOutgoingLabels() const {
+        return outgoing_labels_;
+    }
+
+    const LabelSet& GetIncomingLabels() const {
+        return incoming_labels_;
+    }
+
+private:
+    using HeapItem = std::pair<Weight, VertexId>;
+
+    const Graph& graph_;
+    std::vector<VertexId> vertices_by_rank_;
+    LabelSet outgoing_labels_;
+    LabelSet incoming_labels_;
+
+    static const LabelEntry* FindEntry(const LabelSet& labels, VertexId vertex, uint32_t hub);
+};
+
+// Hubs are taken from the most important vertex down, in the reverse order of contraction of a
+// contraction hierarchy built for the graph (with a degree order labels grow several times larger).
+// A pruned Dijkstra runs from each hub in both directions: a vertex whose route to the hub is already
+// covered by the labels built so far is neither labeled nor expanded.
+template <typename Weight>
+HubLabels<Weight>::HubLabels(const Graph& graph)
+    : graph_(graph)
+{
+    if (!graph.HasIncomingIndex()) {
+        throw std::invalid_argument("Hub labels need the incoming edges index");
+    }
+    const size_t vertex_count = graph.GetVertexCount();
+    if (graph.GetEdgeCount() >= NO_EDGE || vertex_count >= NO_EDGE) {
+        throw std::overflow_error("Graph doesn't fit hub labels");
+    }
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < Weight{}) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+    {
+        const std::vector<uint32_t> contraction_ranks = ContractionHierarchy<Weight>(graph).GetRanks();
+        vertices_by_rank_.resize(vertex_count);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            vertices_by_rank_[vertex_count - 1 - contraction_ranks[vertex]] = vertex;
+        }
+    }
+
+    std::vector<std::vector<LabelEntry>> outgoing(vertex_count);
+    std::vector<std::vector<LabelEntry>> incoming(vertex_count);
+
+    constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::infinity();
+    std::vector<Weight> hub_weights(vertex_count, INFINITE_WEIGHT);  // indexed by hub rank
+    std::vector<Weight> weights(vertex_count, INFINITE_WEIGHT);
+    std::vector<uint32_t> via_edges(vertex_count, NO_EDGE);
+    std::vector<VertexId> reached;
+    std::vector<HeapItem> heap;
+    const auto heap_compare = std::greater<HeapItem>{};
+
+    // is_forward: labels the incoming labels of vertices reachable from the hub, otherwise the outgoing ones
+    const auto run_pruned_search = [&](uint32_t rank, bool is_forward) {
+        const VertexId hub = vertices_by_rank_[rank];
+        auto& hub_labels = is_forward ? outgoing[hub] : incoming[hub];
+        auto& target_labels = is_forward ? incoming : outgoing;
+        for (const LabelEntry& entry : hub_labels) {
+            hub_weights[entry.hub] = entry.weight;
+        }
+
+        weights[hub] = Weight{};
+        via_edges[hub] = NO_EDGE;
+        reached.push_back(hub);
+        heap.push_back({Weight{}, hub});
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), heap_compare);
+            const auto [weight, vertex] = heap.back();
+            heap.pop_back();
+            if (weights[vertex] < weight) {
+                continue;
+            }
+
+            bool is_covered = false;
+            for (const LabelEntry& entry : target_labels[vertex]) {
+                if (hub_weights[entry.hub] != INFINITE_WEIGHT && !(weight < hub_weights[entry.hub] + entry.weight)) {
+                    is_covered = true;
+                    break;
+                }
+            }
+            if (is_covered) {
+                continue;
+            }
+            target_labels[vertex].push_back({rank, via_edges[vertex], weight});
+
+            const auto relax = [&, weight = weight](EdgeId edge_id, VertexId next, Weight edge_weight) {
+                const Weight candidate_weight = weight + edge_weight;
+                if (candidate_weight < weights[next]) {
+                    if (weights[next] == INFINITE_WEIGHT) {
+                        reached.push_back(next);
+                    }
+                    weights[next] = candidate_weight;
+                    via_edges[next] = static_cast<uint32_t>(edge_id);
+                    heap.push_back({candidate_weight, next});
+                    std::push_heap(heap.begin(), heap.end(), heap_compare);
+                }
+            };
+            if (is_forward) {
+                graph.ForEachOutgoingEdge(vertex, relax);
+            } else {
+                graph.ForEachIncomingEdge(vertex, relax);
+            }
+        }
+
+        for (const VertexId vertex : reached) {
+            weights[vertex] = INFINITE_WEIGHT;
+        }
+        reached.clear();
+        for (const LabelEntry& entry : hub_labels) {
+            hub_weights[entry.hub] = INFINITE_WEIGHT;
+        }
+    };
+
+    for (uint32_t rank = 0; rank < vertex_count; ++rank) {
+        run_pruned_search(rank, true);
+        run_pruned_search(rank, false);
+    }
+
+    const auto flatten = [vertex_count](std::vector<std::vector<LabelEntry>>& labels, LabelSet& label_set) {
+        label_set.offsets.assign(vertex_count + 1, 0);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            label_set.offsets[vertex + 1] = label_set.offsets[vertex] + labels[vertex].size();
+        }
+        label_set.entries.reserve(label_set.offsets.back());
+        for (auto& vertex_labels : labels) {
+            label_set.entries.insert(label_set.entries.end(), vertex_labels.begin(), vertex_labels.end());
+            std::vector<LabelEntry>().swap(vertex_labels);
+        }
+    };
+    flatten(outgoing, outgoing_labels_);
+    flatten(incoming, incoming_labels_);
+}
+
+template <typename Weight>
+HubLabels<Weight>::HubLabels(const Graph& graph, std::vector<VertexId> vertices_by_rank, LabelSet outgoing_labels, LabelSet incoming_labels)
+    : graph_(graph)
+    , vertices_by_rank_(std::move(vertices_by_rank))
+    , outgoing_labels_(std::move(outgoing_labels))
+    , incoming_labels_(std::move(incoming_labels))
+{
+    const size_t vertex_count = graph.GetVertexCount();
+    const auto is_valid = [this, vertex_count, &graph](const LabelSet& labels) {
+        if (labels.offsets.size() != vertex_count + 1 || labels.offsets.front() != 0 || labels.offsets.back() != labels.entries.size()
+            || !std::is_sorted(labels.offsets.begin(), labels.offsets.end())) {
+            return false;
+        }
+        return std::all_of(labels.entries.begin(), labels.entries.end(), [this, &graph](const LabelEntry& entry) {
+            return entry.hub < vertices_by_rank_.size() && (entry.via_edge == NO_EDGE || entry.via_edge < graph.GetEdgeCount());
+        });
+    };
+    if (vertices_by_rank_.size() != vertex_count || !is_valid(outgoing_labels_) || !is_valid(incoming_labels_)) {
+        throw std::invalid_argument("Hub labels don't match the graph");
+    }
+}
+
+template <typename Weight>
+const typename HubLabels<Weight>::LabelEntry* HubLabels<Weight>::FindEntry(const LabelSet& labels, VertexId vertex, uint32_t hub) {
+    const auto begin = labels.entries.begin() + labels.offsets[vertex];
+    const auto end = labels.entries.begin() + labels.offsets[vertex + 1];
+    const auto it = std::lower_bound(begin, end, hub, [](const LabelEntry& entry, uint32_t value) {
+        return entry.hub < value;
+    });
+    if (it == end || it->hub != hub) {
+        throw std::logic_error("Hub labels are inconsistent");
+    }
+    return &*it;
+}
+
+template <typename Weight>
+std::optional<typename HubLabels<Weight>::RouteInfo> HubLabels<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    const size_t vertex_count = vertices_by_rank_.size();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    const LabelEntry* out_it = outgoing_labels_.entries.data() + outgoing_labels_.offsets[from];
+    const LabelEntry* const out_end = outgoing_labels_.entries.data() + outgoing_labels_.offsets[from + 1];
+    const LabelEntry* in_it = incoming_labels_.entries.data() + incoming_labels_.offsets[to];
+    const LabelEntry* const in_end = incoming_labels_.entries.data() + incoming_labels_.offsets[to + 1];
+
+    std::optional<Weight> best_weight;
+    uint32_t best_hub = 0;
+    while (out_it != out_end && in_it != in_end) {
+        if (out_it->hub < in_it->hub) {
+            ++out_it;
+        } else if (in_it->hub < out_it->hub) {
+            ++in_it;
+        } else {
+            const Weight weight = out_it->weight + in_it->weight;
+            if (!best_weight || weight < *best_weight) {
+                best_weight = weight;
+                best_hub = out_it->hub;
+            }
+            ++out_it;
+            ++in_it;
+        }
+    }
+    if (!best_weight) {
+        return std::nullopt;
+    }
+
+    // Every vertex on the shortest route to (from) a hub found by its pruned search is labeled with that hub
+    std::vector<EdgeId> edges;
+    for (VertexId vertex = from;;) {
+        const uint32_t via_edge = FindEntry(outgoing_labels_, vertex, best_hub)->via_edge;
+        if (via_edge == NO_EDGE) {
+            break;
+        }
+        edges.push_back(via_edge);
+        vertex = graph_.GetEdge(via_edge).to;
+    }
+    const size_t hub_position = edges.size();
+    for (VertexId vertex = to;;) {
+        const uint32_t via_edge = FindEntry(incoming_labels_, vertex, best_hub)->via_edge;
+        if (via_edge == NO_EDGE) {
+            break;
+        }
+        edges.push_back(via_edge);
+        vertex = graph_.GetEdge(via_edge).from;
+    }
+    std::reverse(edges.begin() + hub_position, edges.end());
+
+    return RouteInfo{*best_weight, std::move(edges)};
+}
+
+}  // namespace graph
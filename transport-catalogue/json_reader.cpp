@@ -1,6 +1,8 @@
 #include "json_reader.h"
 #include "json_builder.h"
 
+#include <algorithm>
+
 namespace transport_catalogue {
     using namespace std::string_literals;
     using namespace std::string_view_literals;
@@ -79,7 +81,15 @@ namespace transport_catalogue {
         case RequestType::GetMap:
             return std::tuple{ stat_request.id, stat_request.type, std::nullopt };
             break;
-        case RequestType::GetRoute: {
+        case RequestType::GetNearestStops:
+        case RequestType::GetStopsInRadius:
+            return std::tuple{ stat_request.id, stat_request.type, std::get<NearbyStopsQuery>(stat_request.request_body.value()) };
+            break;
+        case RequestType::GetRouteByCoordinates:
+            return std::tuple{ stat_request.id, stat_request.type, std::get<CoordinatesRouteQuery>(stat_request.request_body.value()) };
+            break;
+        case RequestType::GetRoute:
+        case RequestType::GetDirectBuses: {
             const std::tuple<std::string,std::string>& request_body = std::get<std::tuple<std::string,std::string>>(stat_request.request_body.value());
             return std::tuple{ stat_request.id,
                 stat_request.type,
@@ -140,11 +150,11 @@ namespace transport_catalogue {
             } 
         }
         else if (request_id_to_type_.at(request_id) == RequestType::GetStopInfo) {
-            if (std::holds_alternative<StopInfo>(info)) {
-                const auto stop_info = std::get<StopInfo>(info);
+            if (std::holds_alternative<StopInfoView>(info)) {
+                const auto& stop_info = std::get<StopInfoView>(info);
                 json::Array buses;
-                for (std::string bus : stop_info.buses) {
-                    buses.emplace_back(bus);
+                for (std::string_view bus : stop_info.buses) {
+                    buses.emplace_back(std::string(bus));
                 }
                 json::Node dict = json::Builder{}
                     .StartDict()
@@ -167,7 +177,8 @@ namespace transport_catalogue {
                     .Build();
             resp_.emplace_back(dict);
         } 
-        else if (request_id_to_type_.at(request_id) == RequestType::GetRoute) {
+        else if (request_id_to_type_.at(request_id) == RequestType::GetRoute
+                 || request_id_to_type_.at(request_id) == RequestType::GetRouteByCoordinates) {
             if (std::holds_alternative<RouteInfo>(info)) {
                 const auto route_info = std::get<RouteInfo>(info);
                 json::Array items;
@@ -184,6 +195,14 @@ namespace transport_catalogue {
                         dict["span_count"s] = static_cast<int>(bus_item.span_count);
                         dict["time"s] = bus_item.time;        
                         dict["type"s] = "Bus"s;
+                    } else if (std::holds_alternative<WalkItem>(item)) {
+                        const auto& walk_item = std::get<WalkItem>(item);
+                        if (!walk_item.stop_name.empty()) {
+                            dict["stop_name"s] = walk_item.stop_name;
+                        }
+                        dict["distance"s] = walk_item.distance;
+                        dict["time"s] = walk_item.time;
+                        dict["type"s] = "Walk"s;
                     }
                     items.emplace_back(dict);
                 }
@@ -199,7 +218,55 @@ namespace transport_catalogue {
             else {
                 printErrorToJson(request_id, info);
             }
-        }      
+        }
+        else if (request_id_to_type_.at(request_id) == RequestType::GetDirectBuses) {
+            if (std::holds_alternative<DirectBusesInfo>(info)) {
+                const auto& direct_buses_info = std::get<DirectBusesInfo>(info);
+                json::Array buses;
+                for (const DirectBusItem& item : direct_buses_info.buses) {
+                    json::Dict dict;
+                    dict["bus"s] = std::string(item.bus);
+                    dict["from_before_to"s] = item.from_before_to;
+                    if (item.from_before_to) {
+                        dict["span_count"s] = static_cast<int>(item.span_count);
+                    }
+                    buses.emplace_back(dict);
+                }
+                json::Node dict = json::Builder{}
+                    .StartDict()
+                        .Key("request_id"s).Value(request_id)
+                        .Key("buses"s).Value(buses)
+                    .EndDict()
+                    .Build();
+                resp_.emplace_back(dict);
+            }
+            else {
+                printErrorToJson(request_id, info);
+            }
+        }
+        else if (request_id_to_type_.at(request_id) == RequestType::GetNearestStops
+                 || request_id_to_type_.at(request_id) == RequestType::GetStopsInRadius) {
+            if (std::holds_alternative<NearbyStopsInfo>(info)) {
+                const auto& nearby_stops_info = std::get<NearbyStopsInfo>(info);
+                json::Array stops;
+                for (const NearbyStopItem& item : nearby_stops_info.stops) {
+                    json::Dict dict;
+                    dict["name"s] = std::string(item.name);
+                    dict["distance"s] = item.distance;
+                    stops.emplace_back(dict);
+                }
+                json::Node dict = json::Builder{}
+                    .StartDict()
+                        .Key("request_id"s).Value(request_id)
+                        .Key("stops"s).Value(stops)
+                    .EndDict()
+                    .Build();
+                resp_.emplace_back(dict);
+            }
+            else {
+                printErrorToJson(request_id, info);
+            }
+        }
     }
 
     void JsonReader::PrintResponses(std::ostream& out) {
@@ -211,10 +278,68 @@ namespace transport_catalogue {
     }
 
     RoutingSettings JsonReader::GetRoutingSettings() {
-        return { 
+        RoutingSettings routing_settings{ 
             routing_settings_.at("bus_velocity").AsDouble(),
             routing_settings_.at("bus_wait_time").AsInt()
         };
+        if (routing_settings_.count("router_engine"s)) {
+            routing_settings.router_engine = ParseRouterEngine(routing_settings_.at("router_engine"s).AsString());
+        }
+        if (routing_settings_.count("graph_model"s)) {
+            routing_settings.graph_model = ParseGraphModel(routing_settings_.at("graph_model"s).AsString());
+        }
+        if (routing_settings_.count("walking_velocity"s)) {
+            routing_settings.walking_velocity = routing_settings_.at("walking_velocity"s).AsDouble();
+        }
+        if (routing_settings_.count("walking_radius"s)) {
+            routing_settings.walking_radius = routing_settings_.at("walking_radius"s).AsDouble();
+        }
+        if (routing_settings_.count("walking_transfer_radius"s)) {
+            routing_settings.walking_transfer_radius = routing_settings_.at("walking_transfer_radius"s).AsDouble();
+        }
+        return routing_settings;
+    }
+
+    GraphModel JsonReader::ParseGraphModel(const std::string& model) {
+        if (model == "stop_pairs"s) {
+            return GraphModel::StopPairs;
+        }
+        else if (model == "bus_lines"s) {
+            return GraphModel::BusLines;
+        }
+        else {
+            throw std::invalid_argument("unknown graph model: "s + model);
+        }
+    }
+
+    RouterEngine JsonReader::ParseRouterEngine(const std::string& engine) {
+        if (engine == "all_pairs"s) {
+            return RouterEngine::AllPairs;
+        }
+        else if (engine == "dijkstra"s) {
+            return RouterEngine::Dijkstra;
+        }
+        else if (engine == "raptor"s) {
+            return RouterEngine::Raptor;
+        }
+        else if (engine == "contraction_hierarchy"s) {
+            return RouterEngine::ContractionHierarchy;
+        }
+        else if (engine == "bidirectional_dijkstra"s) {
+            return RouterEngine::BidirectionalDijkstra;
+        }
+        else if (engine == "a_star"s) {
+            return RouterEngine::AStar;
+        }
+        else if (engine == "alt"s) {
+            return RouterEngine::Alt;
+        }
+        else if (engine == "hub_labels"s) {
+            return RouterEngine::HubLabels;
+        }
+        else {
+            throw std::invalid_argument("unknown router engine: "s + engine);
+        }
     }
 
     std::filesystem::path JsonReader::GetSerializationFilePath() {
@@ -329,6 +454,29 @@ namespace transport_catalogue {
         else if (type_str == "Route"s) {
             return StatRequest{ request.at("id"s).AsInt(), RequestType::GetRoute, std::tuple{ request.at("from"s).AsString(), request.at("to"s).AsString()} };     
         }
+        else if (type_str == "DirectBuses"s) {
+            return StatRequest{ request.at("id"s).AsInt(), RequestType::GetDirectBuses, std::tuple{ request.at("from"s).AsString(), request.at("to"s).AsString()} };
+        }
+        else if (type_str == "NearestStops"s) {
+            NearbyStopsQuery query;
+            query.point = { request.at("latitude"s).AsDouble(), request.at("longitude"s).AsDouble() };
+            query.count = static_cast<size_t>(std::max(request.at("count"s).AsInt(), 0));
+            return StatRequest{ request.at("id"s).AsInt(), RequestType::GetNearestStops, query };
+        }
+        else if (type_str == "StopsInRadius"s) {
+            NearbyStopsQuery query;
+            query.point = { request.at("latitude"s).AsDouble(), request.at("longitude"s).AsDouble() };
+            query.radius = request.at("radius"s).AsDouble();
+            return StatRequest{ request.at("id"s).AsInt(), RequestType::GetStopsInRadius, query };
+        }
+        else if (type_str == "RouteByCoordinates"s) {
+            const json::Dict& from = request.at("from"s).AsMap();
+            const json::Dict& to = request.at("to"s).AsMap();
+            CoordinatesRouteQuery query;
+            query.from = { from.at("latitude"s).AsDouble(), from.at("longitude"s).AsDouble() };
+            query.to = { to.at("latitude"s).AsDouble(), to.at("longitude"s).AsDouble() };
+            return StatRequest{ request.at("id"s).AsInt(), RequestType::GetRouteByCoordinates, query };
+        }
         else {
             return StatRequest{ -1, RequestType::None, std::nullopt };
         }
@@ -19,7 +19,7 @@
 namespace transport_catalogue {
     class JsonReader {
     private:
-        using RequestBody = std::variant<std::string,std::tuple<std::string,std::string>>;
+        using RequestBody = std::variant<std::string,std::tuple<std::string,std::string>,NearbyStopsQuery,CoordinatesRouteQuery>;
 
         struct BaseRequest {
             RequestType type;
@@ -67,5 +67,7 @@ namespace transport_catalogue {
         Stop ParseStop(const json::Dict& request);
         Bus ParseBus(const json::Dict& request);
         RenderSettings ParseRendererSettings(const json::Dict& settings);
+        RouterEngine ParseRouterEngine(const std::string& engine);
+        GraphModel ParseGraphModel(const std::string& model);
     };
 }
\ No newline at end of file
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Route weights from and to a few landmark vertices, giving lower bounds of the route weight between
+// any two vertices by the triangle inequality (the ALT heuristic for A*):
+//   d(v, t) >= d(L, t) - d(L, v)   and   d(v, t) >= d(v, L) - d(t, L)
+// Landmarks are picked farthest-first, so they end up at the edges of the graph, where the bounds are tight.
+// Building needs the incoming index of the graph (EnableIncomingIndex) for the weights towards landmarks.
+template <typename Weight>
+class Landmarks {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    static constexpr size_t DEFAULT_LANDMARK_COUNT = 16;
+    static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::infinity();
+
+    explicit Landmarks(const Graph& graph, size_t landmark_count = DEFAULT_LANDMARK_COUNT);
+    // Restores landmarks computed earlier for the same graph; the weights are laid out as GetWeightsFromLandmarks describes
+    Landmarks(const Graph& graph, std::vector<VertexId> landmarks, std::vector<Weight> weights_from_landmarks,
+              std::vector<Weight> weights_to_landmarks);
+
+    Weight GetLowerBound(VertexId from, VertexId to) const;
+
+    const std::vector<VertexId>& GetLandmarks() const {
+        return landmarks_;
+    }
+
+    // Vertex-major: the weight from the i-th landmark to vertex v is at v * landmark_count + i
+    const std::vector<Weight>& GetWeightsFromLandmarks() const {
+        return weights_from_landmarks_;
+    }
+
+    const std::vector<Weight>& GetWeightsToLandmarks() const {
+        return weights_to_landmarks_;
+    }
+
+private:
+    size_t vertex_count_;
+    std::vector<VertexId> landmarks_;
+    std::vector<Weight> weights_from_landmarks_;
+    std::vector<Weight> weights_to_landmarks_;
+
+    static std::vector<Weight> ComputeWeights(const Graph& graph, VertexId source, bool is_forward);
+};
+
+// Plain Dijkstra over the whole graph, along the edges or against them
+template <typename Weight>
+std::vector<Weight> Landmarks<Weight>::ComputeWeights(const Graph& graph, VertexId source, bool is_forward) {
+    using HeapItem = std::pair<Weight, VertexId>;
+    const auto heap_compare = std::greater<HeapItem>{};
+
+    std::vector<Weight> weights(graph.GetVertexCount(), INFINITE_WEIGHT);
+    std::vector<HeapItem> heap;
+    weights[source] = Weight{};
+    heap.push_back({Weight{}, source});
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), heap_compare);
+        const auto [weight, vertex] = heap.back();
+        heap.pop_back();
+        if (weights[vertex] < weight) {
+            continue;
+        }
+        const auto relax = [&weights, &heap, &heap_compare, weight = weight](EdgeId, VertexId next, Weight edge_weight) {
+            const Weight candidate_weight = weight + edge_weight;
+            if (candidate_weight < weights[next]) {
+                weights[next] = candidate_weight;
+                heap.push_back({candidate_weight, next});
+                std::push_heap(heap.begin(), heap.end(), heap_compare);
+            }
+        };
+        if (is_forward) {
+            graph.ForEachOutgoingEdge(vertex, relax);
+        } else {
+            graph.ForEachIncomingEdge(vertex, relax);
+        }
+    }
+    return weights;
+}
+
+template <typename Weight>
+Landmarks<Weight>::Landmarks(const Graph& graph, size_t landmark_count)
+    : vertex_count_(graph.GetVertexCount())
+{
+    if (!graph.HasIncomingIndex()) {
+        throw std::invalid_argument("Landmarks need the incoming edges index");
+    }
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < Weight{}) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+    landmark_count = std::min(landmark_count, vertex_count_);
+
+    // The first landmark is the vertex farthest from vertex 0, every next one is the vertex farthest
+    // from the landmarks already picked. Vertices none of them reaches count as the farthest,
+    // vertices without edges are never picked.
+    std::vector<bool> has_edges(vertex_count_, false);
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        has_edges[graph.GetEdge(edge_id).from] = true;
+        has_edges[graph.GetEdge(edge_id).to] = true;
+    }
+    std::vector<std::vector<Weight>> weights_from;
+    std::vector<std::vector<Weight>> weights_to;
+    std::vector<Weight> weights_to_picked = (vertex_count_ > 0) ? ComputeWeights(graph, 0, true) : std::vector<Weight>{};
+    while (landmarks_.size() < landmark_count) {
+        std::optional<VertexId> farthest;
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            if (!has_edges[vertex] || std::find(landmarks_.begin(), landmarks_.end(), vertex) != landmarks_.end()) {
+                continue;
+            }
+            if (!farthest || weights_to_picked[*farthest] < weights_to_picked[vertex]) {
+                farthest = vertex;
+            }
+        }
+        if (!farthest) {
+            break;
+        }
+        landmarks_.push_back(*farthest);
+        weights_from.push_back(ComputeWeights(graph, *farthest, true));
+        weights_to.push_back(ComputeWeights(graph, *farthest, false));
+
+        if (landmarks_.size() == 1) {
+            weights_to_picked = weights_from.back();
+        } else {
+            for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+                weights_to_picked[vertex] = std::min(weights_to_picked[vertex], weights_from.back()[vertex]);
+            }
+        }
+    }
+
+    const size_t picked_count = landmarks_.size();
+    weights_from_landmarks_.resize(vertex_count_ * picked_count);
+    weights_to_landmarks_.resize(vertex_count_ * picked_count);
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+        for (size_t i = 0; i < picked_count; ++i) {
+            weights_from_landmarks_[vertex * picked_count + i] = weights_from[i][vertex];
+            weights_to_landmarks_[vertex * picked_count + i] = weights_to[i][vertex];
+        }
+    }
+}
+
+template <typename Weight>
+Landmarks<Weight>::Landmarks(const Graph& graph, std::vector<VertexId> landmarks, std::vector<Weight> weights_from_landmarks,
+                             std::vector<Weight> weights_to_landmarks)
+    : vertex_count_(graph.GetVertexCount())
+    , landmarks_(std::move(landmarks))
+    , weights_from_landmarks_(std::move(weights_from_landmarks))
+    , weights_to_landmarks_(std::move(weights_to_landmarks))
+{
+    const size_t table_size = vertex_count_ * landmarks_.size();
+    if (weights_from_landmarks_.size() != table_size || weights_to_landmarks_.size() != table_size
+        || std::any_of(landmarks_.begin(), landmarks_.end(), [this](VertexId landmark) { return landmark >= vertex_count_; })) {
+        throw std::invalid_argument("Landmarks don't match the graph");
+    }
+}
+
+template <typename Weight>
+Weight Landmarks<Weight>::GetLowerBound(VertexId from, VertexId to) const {
+    const size_t landmark_count = landmarks_.size();
+    const Weight* from_landmarks_to_from = weights_from_landmarks_.data() + from * landmark_count;
+    const Weight* from_landmarks_to_to = weights_from_landmarks_.data() + to * landmark_count;
+    const Weight* from_from_to_landmarks = weights_to_landmarks_.data() + from * landmark_count;
+    const Weight* from_to_to_landmarks = weights_to_landmarks_.data() + to * landmark_count;
+
+    // Terms with an infinite weight bound nothing and are skipped
+    Weight bound{};
+    for (size_t i = 0; i < landmark_count; ++i) {
+        if (from_landmarks_to_from[i] != INFINITE_WEIGHT && from_landmarks_to_to[i] != INFINITE_WEIGHT) {
+            bound = std::max(bound, from_landmarks_to_to[i] - from_landmarks_to_from[i]);
+        }
+        if (from_from_to_landmarks[i] != INFINITE_WEIGHT && from_to_to_landmarks[i] != INFINITE_WEIGHT) {
+            bound = std::max(bound, from_from_to_landmarks[i] - from_to_to_landmarks[i]);
+        }
+    }
+    return bound;
+}
+
+}  // namespace graph
@@ -47,6 +47,7 @@ int main(int argc, char* argv[]) {
         for (size_t i=0; i < reader.GetBaseRequestCount(); i++) {
             request_handler.BaseRequest(reader.GetBaseRequest(i));
         }
+        transport_catalogue.Freeze();
         map_renderer.SetUp(reader.GetRendererSettings());
         transport_router.SetUp(reader.GetRoutingSettings());
 
@@ -56,6 +57,13 @@ int main(int argc, char* argv[]) {
         std::ifstream ifs(reader.GetSerializationFilePath(), ios::binary);
         transport_catalogue_serializer.DeserializeFromIstream(ifs);
 
+        // Base requests sent along with the stat requests add buses to the loaded base without rebuilding it
+        for (size_t i=0; i < reader.GetBaseRequestCount(); i++) {
+            request_handler.BaseRequest(reader.GetBaseRequest(i));
+        }
+        transport_catalogue.Freeze();
+        request_handler.AddBusesToRouter();
+
         for (size_t i=0; i < reader.GetStatRequestCount(); i++) {
             reader.AddResponse(request_handler.StatRequest(reader.GetStatRequest(i)));
         }
@@ -0,0 +1,180 @@
+#include "min_plus.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define MIN_PLUS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace graph {
+
+namespace {
+
+template <typename Weight>
+void RelaxRowScalar(Weight weight_from, const Weight* weights_through, const uint32_t* prev_edges_through,
+                    Weight* weights, uint32_t* prev_edges, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const Weight candidate_weight = weight_from + weights_through[i];
+        if (candidate_weight < weights[i]) {
+            weights[i] = candidate_weight;
+            prev_edges[i] = prev_edges_through[i];
+        }
+    }
+}
+
+#ifdef MIN_PLUS_X86_KERNELS
+
+__attribute__((target("avx2")))
+void RelaxRowAvx2(double weight_from, const double* weights_through, const uint32_t* prev_edges_through,
+                  double* weights, uint32_t* prev_edges, size_t count) {
+    const __m256d from = _mm256_set1_pd(weight_from);
+    // picks the low halves of the four 64-bit compare masks
+    const __m256i mask_to_32 = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d candidate = _mm256_add_pd(from, _mm256_loadu_pd(weights_through + i));
+        const __m256d current = _mm256_loadu_pd(weights + i);
+        const __m256d mask = _mm256_cmp_pd(candidate, current, _CMP_LT_OQ);
+        if (_mm256_movemask_pd(mask) == 0) {
+            continue;
+        }
+        _mm256_storeu_pd(weights + i, _mm256_blendv_pd(current, candidate, mask));
+
+        const __m128i mask32 = _mm256_castsi256_si128(
+            _mm256_permutevar8x32_epi32(_mm256_castpd_si256(mask), mask_to_32));
+        const __m128i current_prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev_edges + i));
+        const __m128i candidate_prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev_edges_through + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(prev_edges + i), _mm_blendv_epi8(current_prev, candidate_prev, mask32));
+    }
+    RelaxRowScalar(weight_from, weights_through + i, prev_edges_through + i, weights + i, prev_edges + i, count - i);
+}
+
+__attribute__((target("avx2")))
+void RelaxRowAvx2(float weight_from, const float* weights_through, const uint32_t* prev_edges_through,
+                  float* weights, uint32_t* prev_edges, size_t count) {
+    const __m256 from = _mm256_set1_ps(weight_from);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 candidate = _mm256_add_ps(from, _mm256_loadu_ps(weights_through + i));
+        const __m256 current = _mm256_loadu_ps(weights + i);
+        const __m256 mask = _mm256_cmp_ps(candidate, current, _CMP_LT_OQ);
+        if (_mm256_movemask_ps(mask) == 0) {
+            continue;
+        }
+        _mm256_storeu_ps(weights + i, _mm256_blendv_ps(current, candidate, mask));
+
+        const __m256i current_prev = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prev_edges + i));
+        const __m256i candidate_prev = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prev_edges_through + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(prev_edges + i),
+                            _mm256_blendv_epi8(current_prev, candidate_prev, _mm256_castps_si256(mask)));
+    }
+    RelaxRowScalar(weight_from, weights_through + i, prev_edges_through + i, weights + i, prev_edges + i, count - i);
+}
+
+__attribute__((target("sse4.1")))
+void RelaxRowSse4(double weight_from, const double* weights_through, const uint32_t* prev_edges_through,
+                  double* weights, uint32_t* prev_edges, size_t count) {
+    const __m128d from = _mm_set1_pd(weight_from);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const __m128d candidate = _mm_add_pd(from, _mm_loadu_pd(weights_through + i));
+        const __m128d current = _mm_loadu_pd(weights + i);
+        const __m128d mask = _mm_cmplt_pd(candidate, current);
+        if (_mm_movemask_pd(mask) == 0) {
+            continue;
+        }
+        _mm_storeu_pd(weights + i, _mm_blendv_pd(current, candidate, mask));
+
+        const __m128i mask32 = _mm_shuffle_epi32(_mm_castpd_si128(mask), _MM_SHUFFLE(3, 3, 2, 0));
+        const __m128i current_prev = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(prev_edges + i));
+        const __m128i candidate_prev = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(prev_edges_through + i));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(prev_edges + i), _mm_blendv_epi8(current_prev, candidate_prev, mask32));
+    }
+    RelaxRowScalar(weight_from, weights_through + i, prev_edges_through + i, weights + i, prev_edges + i, count - i);
+}
+
+__attribute__((target("sse4.1")))
+void RelaxRowSse4(float weight_from, const float* weights_through, const uint32_t* prev_edges_through,
+                  float* weights, uint32_t* prev_edges, size_t count) {
+    const __m128 from = _mm_set1_ps(weight_from);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 candidate = _mm_add_ps(from, _mm_loadu_ps(weights_through + i));
+        const __m128 current = _mm_loadu_ps(weights + i);
+        const __m128 mask = _mm_cmplt_ps(candidate, current);
+        if (_mm_movemask_ps(mask) == 0) {
+            continue;
+        }
+        _mm_storeu_ps(weights + i, _mm_blendv_ps(current, candidate, mask));
+
+        const __m128i current_prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev_edges + i));
+        const __m128i candidate_prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev_edges_through + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(prev_edges + i),
+                         _mm_blendv_epi8(current_prev, candidate_prev, _mm_castps_si128(mask)));
+    }
+    RelaxRowScalar(weight_from, weights_through + i, prev_edges_through + i, weights + i, prev_edges + i, count - i);
+}
+
+#endif  // MIN_PLUS_X86_KERNELS
+
+enum class KernelKind { Scalar, Sse4, Avx2 };
+
+KernelKind DetectKernel() {
+#ifdef MIN_PLUS_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return KernelKind::Avx2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return KernelKind::Sse4;
+    }
+#endif
+    return KernelKind::Scalar;
+}
+
+KernelKind GetKernelKind() {
+    static const KernelKind kernel_kind = DetectKernel();
+    return kernel_kind;
+}
+
+template <typename Weight>
+void RelaxRow(Weight weight_from, const Weight* weights_through, const uint32_t* prev_edges_through,
+              Weight* weights, uint32_t* prev_edges, size_t count) {
+    switch (GetKernelKind()) {
+#ifdef MIN_PLUS_X86_KERNELS
+    case KernelKind::Avx2:
+        RelaxRowAvx2(weight_from, weights_through, prev_edges_through, weights, prev_edges, count);
+        break;
+    case KernelKind::Sse4:
+        RelaxRowSse4(weight_from, weights_through, prev_edges_through, weights, prev_edges, count);
+        break;
+#endif
+    default:
+        RelaxRowScalar(weight_from, weights_through, prev_edges_through, weights, prev_edges, count);
+        break;
+    }
+}
+
+}  // namespace
+
+void RelaxRowMinPlus(double weight_from, const double* weights_through, const uint32_t* prev_edges_through,
+                     double* weights, uint32_t* prev_edges, size_t count) {
+    RelaxRow(weight_from, weights_through, prev_edges_through, weights, prev_edges, count);
+}
+
+void RelaxRowMinPlus(float weight_from, const float* weights_through, const uint32_t* prev_edges_through,
+                     float* weights, uint32_t* prev_edges, size_t count) {
+    RelaxRow(weight_from, weights_through, prev_edges_through, weights, prev_edges, count);
+}
+
+const char* GetMinPlusKernelName() {
+    switch (GetKernelKind()) {
+    case KernelKind::Avx2:
+        return "avx2";
+    case KernelKind::Sse4:
+        return "sse4.1";
+    default:
+        return "scalar";
+    }
+}
+
+}  // namespace graph
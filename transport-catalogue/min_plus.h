@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace graph {
+
+// Min-plus row update of the Floyd-Warshall relaxation:
+//   for every i < count: if weight_from + weights_through[i] < weights[i] then
+//       weights[i] = weight_from + weights_through[i], prev_edges[i] = prev_edges_through[i]
+// Unreachable cells are expected to hold infinity. The implementation (AVX2, SSE4.1 or scalar)
+// is picked once at runtime by CPU detection.
+void RelaxRowMinPlus(double weight_from, const double* weights_through, const uint32_t* prev_edges_through,
+                     double* weights, uint32_t* prev_edges, size_t count);
+void RelaxRowMinPlus(float weight_from, const float* weights_through, const uint32_t* prev_edges_through,
+                     float* weights, uint32_t* prev_edges, size_t count);
+
+// Name of the implementation picked on this CPU: "avx2", "sse4.1" or "scalar"
+const char* GetMinPlusKernelName();
+
+}  // namespace graph
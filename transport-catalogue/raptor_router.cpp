@@ -0,0 +1,359 @@
+#include "raptor_router.h"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+namespace transport_catalogue {
+    using namespace std::string_literals;
+
+    RaptorRouter::RaptorRouter(const TransportCatalogue& tc, const RoutingSettings& routing_settings)
+        : bus_wait_time_(static_cast<double>(routing_settings.bus_wait_time)) {
+        constexpr double SECONDS_IN_MINUTE = 60.0;
+        constexpr double METERS_IN_KILOMETER = 1000.0;
+        const double meters_to_minutes_multiplier = 1.0 / METERS_IN_KILOMETER / routing_settings.bus_velocity * SECONDS_IN_MINUTE;
+
+        stop_names_ = tc.GetStopList();
+
+        std::vector<size_t> stop_pattern_counts(stop_names_.size() + 1, 0);
+        for (BusId bus_id = 0; bus_id < tc.GetBusCount(); ++bus_id) {
+            const BusRoute& bus = tc.GetBus(bus_id);
+            if (bus.stop_ids.empty()) {
+                continue;
+            }
+
+            const size_t stops_count = bus.stop_ids.size();
+            const size_t total_stops_count = (bus.is_circular_route) ? stops_count : 2 * stops_count - 1;
+            auto segment_distance = tc.GetSnapshot().GetSegmentDistances(bus_id).begin();
+
+            Pattern pattern;
+            pattern.bus = bus.num;
+            pattern.stops.reserve(total_stops_count);
+            pattern.arrival_times.reserve(total_stops_count);
+            for (size_t transparent = 0; transparent < total_stops_count; ++transparent) {
+                const size_t index = (transparent < stops_count) ? transparent : total_stops_count - 1 - transparent;
+                const StopIndex stop = bus.stop_ids[index];
+                double arrival_time = 0.0;
+                if (transparent > 0) {
+                    arrival_time = pattern.arrival_times.back() + *segment_distance++ * meters_to_minutes_multiplier;
+                }
+                pattern.stops.push_back(stop);
+                pattern.arrival_times.push_back(arrival_time);
+                ++stop_pattern_counts[stop + 1];
+            }
+            patterns_.push_back(std::move(pattern));
+        }
+
+        for (size_t stop = 0; stop < stop_names_.size(); ++stop) {
+            stop_pattern_counts[stop + 1] += stop_pattern_counts[stop];
+        }
+        stop_pattern_offsets_ = stop_pattern_counts;
+        stop_patterns_.resize(stop_pattern_offsets_.back());
+        for (PatternIndex pattern_index = 0; pattern_index < patterns_.size(); ++pattern_index) {
+            const auto& stops = patterns_[pattern_index].stops;
+            for (uint32_t position = 0; position < stops.size(); ++position) {
+                stop_patterns_[stop_pattern_counts[stops[position]]++] = { pattern_index, position };
+            }
+        }
+
+        BuildFootpaths(tc, routing_settings);
+    }
+
+    // The same pairs and times as the walk edges of the route graph, so RAPTOR and the graph engines agree
+    void RaptorRouter::BuildFootpaths(const TransportCatalogue& tc, const RoutingSettings& routing_settings) {
+        footpath_offsets_.assign(stop_names_.size() + 1, 0);
+        if (!(routing_settings.walking_transfer_radius > 0.0)) {
+            return;
+        }
+        if (!(routing_settings.walking_velocity > 0.0)) {
+            throw std::invalid_argument("walking velocity should be positive"s);
+        }
+        constexpr double SECONDS_IN_MINUTE = 60.0;
+        constexpr double METERS_IN_KILOMETER = 1000.0;
+        walking_meters_to_minutes_multiplier_ = 1.0 / METERS_IN_KILOMETER / routing_settings.walking_velocity * SECONDS_IN_MINUTE;
+
+        std::vector<SpatialGrid::StopPair> stop_pairs = tc.GetSnapshot().GetSpatialGrid().FindStopPairsInRadius(routing_settings.walking_transfer_radius);
+        stop_pairs.erase(std::remove_if(stop_pairs.begin(), stop_pairs.end(), [this](const SpatialGrid::StopPair& stop_pair) {
+            return !HasStop(stop_pair.from) || !HasStop(stop_pair.to);
+        }), stop_pairs.end());
+        for (const auto& [from, to, distance] : stop_pairs) {
+            ++footpath_offsets_[from + 1];
+            ++footpath_offsets_[to + 1];
+        }
+        for (size_t stop = 0; stop < stop_names_.size(); ++stop) {
+            footpath_offsets_[stop + 1] += footpath_offsets_[stop];
+        }
+        footpaths_.resize(footpath_offsets_.back());
+        std::vector<size_t> positions(footpath_offsets_.begin(), footpath_offsets_.end() - 1);
+        for (const auto& [from, to, distance] : stop_pairs) {
+            const double time = distance * walking_meters_to_minutes_multiplier_;
+            footpaths_[positions[from]++] = { to, time };
+            footpaths_[positions[to]++] = { from, time };
+        }
+    }
+
+    bool RaptorRouter::HasStop(StopId stop) const {
+        return stop < stop_names_.size() && stop_pattern_offsets_[stop] != stop_pattern_offsets_[stop + 1];
+    }
+
+    void RaptorRouter::SearchScratch::Prepare(size_t stop_count, size_t pattern_count) {
+        for (const StopIndex stop : touched_stops) {
+            best_times[stop] = INFINITE_TIME;
+            round_start_times[stop] = INFINITE_TIME;
+            labels[stop] = Label{};
+        }
+        for (const StopIndex stop : target_stops) {
+            target_times[stop] = INFINITE_TIME;
+        }
+        touched_stops.clear();
+        marked_stops.clear();
+        queued_patterns.clear();
+        target_stops.clear();
+        target_bound = INFINITE_TIME;
+
+        if (best_times.size() < stop_count) {
+            best_times.resize(stop_count, INFINITE_TIME);
+            round_start_times.resize(stop_count, INFINITE_TIME);
+            labels.resize(stop_count);
+            is_marked.resize(stop_count, false);
+            target_times.resize(stop_count, INFINITE_TIME);
+        }
+        if (pattern_start_positions.size() < pattern_count) {
+            pattern_start_positions.resize(pattern_count, NONE);
+        }
+    }
+
+    void RaptorRouter::SearchScratch::Touch(StopIndex stop) {
+        if (best_times[stop] == INFINITE_TIME) {
+            touched_stops.push_back(stop);
+        }
+    }
+
+    void RaptorRouter::SearchScratch::AddSource(StopIndex stop, double time) {
+        if (time < best_times[stop]) {
+            Touch(stop);
+            best_times[stop] = time;
+            round_start_times[stop] = time;
+            if (!is_marked[stop]) {
+                is_marked[stop] = true;
+                marked_stops.push_back(stop);
+            }
+            UpdateTargetBound(stop);
+        }
+    }
+
+    // Sources are added after the targets, so a stop being both is accounted for in the bound
+    void RaptorRouter::SearchScratch::AddTarget(StopIndex stop, double time) {
+        if (target_times[stop] == INFINITE_TIME) {
+            target_stops.push_back(stop);
+        }
+        target_times[stop] = std::min(target_times[stop], time);
+    }
+
+    void RaptorRouter::SearchScratch::UpdateTargetBound(StopIndex stop) {
+        if (target_times[stop] != INFINITE_TIME) {
+            target_bound = std::min(target_bound, best_times[stop] + target_times[stop]);
+        }
+    }
+
+    RaptorRouter::SearchScratch& RaptorRouter::GetScratch() {
+        thread_local SearchScratch scratch;
+        return scratch;
+    }
+
+    std::optional<RouteInfo> RaptorRouter::BuildRoute(StopId from, StopId to) const {
+        if (!HasStop(from) || !HasStop(to)) {
+            throw std::out_of_range("not found"s);
+        }
+
+        SearchScratch& scratch = GetScratch();
+        scratch.Prepare(stop_names_.size(), patterns_.size());
+        scratch.AddTarget(to, 0.0);
+        scratch.AddSource(from, 0.0);
+        RunRounds(scratch);
+
+        if (scratch.best_times[to] == INFINITE_TIME) {
+            return std::nullopt;
+        }
+        return std::move(ReconstructRoute(to, scratch).route);
+    }
+
+    std::optional<RaptorRouter::EndpointsRoute> RaptorRouter::BuildRoute(const std::vector<StopOffset>& sources,
+                                                                          const std::vector<StopOffset>& targets) const {
+        for (const auto& endpoints : {&sources, &targets}) {
+            for (const StopOffset& endpoint : *endpoints) {
+                if (!HasStop(endpoint.stop)) {
+                    throw std::out_of_range("not found"s);
+                }
+                if (endpoint.time < 0.0) {
+                    throw std::invalid_argument("negative endpoint time"s);
+                }
+            }
+        }
+
+        SearchScratch& scratch = GetScratch();
+        scratch.Prepare(stop_names_.size(), patterns_.size());
+        for (const auto& [stop, time] : targets) {
+            scratch.AddTarget(stop, time);
+        }
+        for (const auto& [stop, time] : sources) {
+            scratch.AddSource(stop, time);
+        }
+        RunRounds(scratch);
+
+        if (scratch.target_bound == INFINITE_TIME) {
+            return std::nullopt;
+        }
+        StopIndex best_target = scratch.target_stops.front();
+        for (const StopIndex stop : scratch.target_stops) {
+            if (scratch.best_times[stop] + scratch.target_times[stop] < scratch.best_times[best_target] + scratch.target_times[best_target]) {
+                best_target = stop;
+            }
+        }
+        EndpointsRoute route = ReconstructRoute(best_target, scratch);
+        route.route.total_time += scratch.target_times[best_target];
+        return route;
+    }
+
+    void RaptorRouter::RunRounds(SearchScratch& scratch) const {
+        RelaxFootpaths(scratch);
+        for (const StopIndex stop : scratch.marked_stops) {
+            scratch.round_start_times[stop] = scratch.best_times[stop];
+        }
+        while (!scratch.marked_stops.empty()) {
+            for (const StopIndex stop : scratch.marked_stops) {
+                scratch.is_marked[stop] = false;
+                for (size_t i = stop_pattern_offsets_[stop]; i < stop_pattern_offsets_[stop + 1]; ++i) {
+                    const auto [pattern, position] = stop_patterns_[i];
+                    uint32_t& start_position = scratch.pattern_start_positions[pattern];
+                    if (start_position == NONE) {
+                        scratch.queued_patterns.push_back(pattern);
+                        start_position = position;
+                    } else {
+                        start_position = std::min(start_position, position);
+                    }
+                }
+            }
+            scratch.marked_stops.clear();
+
+            for (const PatternIndex pattern : scratch.queued_patterns) {
+                ScanPattern(pattern, scratch.pattern_start_positions[pattern], scratch);
+                scratch.pattern_start_positions[pattern] = NONE;
+            }
+            scratch.queued_patterns.clear();
+
+            RelaxFootpaths(scratch);
+            for (const StopIndex stop : scratch.marked_stops) {
+                scratch.round_start_times[stop] = scratch.best_times[stop];
+            }
+        }
+    }
+
+    // A Dijkstra over the footpaths from the stops marked in this round, so a chain of walks is relaxed
+    // as on the graph; the stops reached on foot are marked for the next round as well
+    void RaptorRouter::RelaxFootpaths(SearchScratch& scratch) const {
+        if (footpaths_.empty()) {
+            return;
+        }
+        auto& heap = scratch.walk_heap;
+        const auto heap_compare = std::greater<std::pair<double, StopIndex>>{};
+        heap.clear();
+        for (const StopIndex stop : scratch.marked_stops) {
+            heap.push_back({ scratch.best_times[stop], stop });
+        }
+        std::make_heap(heap.begin(), heap.end(), heap_compare);
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), heap_compare);
+            const auto [time, stop] = heap.back();
+            heap.pop_back();
+            if (scratch.best_times[stop] < time) {
+                continue;
+            }
+            for (size_t i = footpath_offsets_[stop]; i < footpath_offsets_[stop + 1]; ++i) {
+                const Footpath& footpath = footpaths_[i];
+                const double arrival_time = time + footpath.time;
+                if (arrival_time < scratch.best_times[footpath.to] && arrival_time < scratch.target_bound) {
+                    scratch.Touch(footpath.to);
+                    scratch.best_times[footpath.to] = arrival_time;
+                    scratch.labels[footpath.to] = Label{ NONE, 0, 0, stop };
+                    scratch.UpdateTargetBound(footpath.to);
+                    if (!scratch.is_marked[footpath.to]) {
+                        scratch.is_marked[footpath.to] = true;
+                        scratch.marked_stops.push_back(footpath.to);
+                    }
+                    heap.push_back({ arrival_time, footpath.to });
+                    std::push_heap(heap.begin(), heap.end(), heap_compare);
+                }
+            }
+        }
+    }
+
+    void RaptorRouter::ScanPattern(PatternIndex pattern_index, uint32_t start_position, SearchScratch& scratch) const {
+        const Pattern& pattern = patterns_[pattern_index];
+
+        // Boarding at position i and riding to position j takes round_start_time(i) + wait + arrival(j) - arrival(i),
+        // so it is enough to keep the best round_start_time(i) + wait - arrival(i) over the positions passed
+        double boarded_time = INFINITE_TIME;
+        uint32_t board_position = 0;
+        for (uint32_t position = start_position; position < pattern.stops.size(); ++position) {
+            const StopIndex stop = pattern.stops[position];
+
+            if (boarded_time != INFINITE_TIME) {
+                const double arrival_time = boarded_time + pattern.arrival_times[position];
+                if (arrival_time < scratch.best_times[stop] && arrival_time < scratch.target_bound) {
+                    scratch.Touch(stop);
+                    scratch.best_times[stop] = arrival_time;
+                    scratch.labels[stop] = Label{ pattern_index, board_position, position };
+                    scratch.UpdateTargetBound(stop);
+                    if (!scratch.is_marked[stop]) {
+                        scratch.is_marked[stop] = true;
+                        scratch.marked_stops.push_back(stop);
+                    }
+                }
+            }
+
+            const double round_start_time = scratch.round_start_times[stop];
+            if (round_start_time != INFINITE_TIME) {
+                const double candidate_time = round_start_time + bus_wait_time_ - pattern.arrival_times[position];
+                if (candidate_time < boarded_time) {
+                    boarded_time = candidate_time;
+                    board_position = position;
+                }
+            }
+        }
+    }
+
+    // The journey is followed back from the target until a stop reached neither by bus nor on foot, i.e. a source
+    RaptorRouter::EndpointsRoute RaptorRouter::ReconstructRoute(StopIndex to, const SearchScratch& scratch) const {
+        RouteInfo route_info;
+        route_info.total_time = scratch.best_times[to];
+
+        size_t legs_count = 0;
+        StopIndex stop = to;
+        while (scratch.labels[stop].pattern != NONE || scratch.labels[stop].walk_from != NONE) {
+            const Label& label = scratch.labels[stop];
+            if (++legs_count > 2 * stop_names_.size()) {
+                throw std::logic_error("broken RAPTOR journey"s);
+            }
+            if (label.pattern == NONE) {
+                const auto footpath = std::find_if(footpaths_.begin() + footpath_offsets_[label.walk_from],
+                                                   footpaths_.begin() + footpath_offsets_[label.walk_from + 1],
+                                                   [stop](const Footpath& footpath) { return footpath.to == stop; });
+                const double time = footpath->time;
+                route_info.items.emplace_back(WalkItem{ std::string(stop_names_[stop]), time / walking_meters_to_minutes_multiplier_, time });
+                stop = label.walk_from;
+                continue;
+            }
+            const Pattern& pattern = patterns_[label.pattern];
+            const StopIndex board_stop = pattern.stops[label.board_position];
+            route_info.items.emplace_back(BusItem{ std::string(pattern.bus), label.alight_position - label.board_position,
+                pattern.arrival_times[label.alight_position] - pattern.arrival_times[label.board_position] });
+            route_info.items.emplace_back(WaitItem{ std::string(stop_names_[board_stop]), bus_wait_time_ });
+            stop = board_stop;
+        }
+        std::reverse(route_info.items.begin(), route_info.items.end());
+
+        return EndpointsRoute{ std::move(route_info), stop, to };
+    }
+}
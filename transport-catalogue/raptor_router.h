@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "domain.h"
+#include "transport_catalogue.h"
+
+namespace transport_catalogue {
+// Round-based public transit routing (RAPTOR) straight over the bus routes of the catalogue.
+// Round k scans every route serving a stop improved in round k - 1, so a journey found in
+// round k uses k boardings. Every boarding costs the bus wait time. No graph is built:
+// preprocessing only resolves routes to stop indices and prefix sums of travel times.
+// With walking transfers, footpaths between stops within the walking transfer radius are
+// relaxed after the sources are seeded and after every round.
+class RaptorRouter {
+public:
+    RaptorRouter(const TransportCatalogue& tc, const RoutingSettings& routing_settings);
+
+    std::optional<RouteInfo> BuildRoute(StopId from, StopId to) const;
+
+    // A stop a journey may start or end at, with the time of getting to it or away from it
+    struct StopOffset {
+        StopId stop;
+        double time;
+    };
+
+    struct EndpointsRoute {
+        RouteInfo route;  // the total time includes the offsets of both endpoints
+        StopId source;
+        StopId target;
+    };
+
+    // The best journey from any of the sources to any of the targets, all the sources seeded into the same rounds
+    std::optional<EndpointsRoute> BuildRoute(const std::vector<StopOffset>& sources, const std::vector<StopOffset>& targets) const;
+
+    // Whether some bus serves the stop
+    bool HasStop(StopId stop) const;
+
+private:
+    using StopIndex = StopId;
+    using PatternIndex = uint32_t;
+
+    static constexpr double INFINITE_TIME = std::numeric_limits<double>::infinity();
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    // Stop sequence of a bus as it is actually driven: a linear route is unrolled into there and back
+    struct Pattern {
+        std::string_view bus;
+        std::vector<StopIndex> stops;
+        std::vector<double> arrival_times;  // prefix sums of the ride time from the first stop
+    };
+
+    struct PatternStop {
+        PatternIndex pattern;
+        uint32_t position;
+    };
+
+    struct Footpath {
+        StopIndex to;
+        double time;
+    };
+
+    // How the best known arrival at a stop was reached: by a pattern or on foot from another stop
+    struct Label {
+        PatternIndex pattern = NONE;
+        uint32_t board_position = 0;
+        uint32_t alight_position = 0;
+        StopIndex walk_from = NONE;
+    };
+
+    struct SearchScratch {
+        std::vector<double> best_times;
+        std::vector<double> round_start_times;
+        std::vector<Label> labels;
+        std::vector<bool> is_marked;
+        std::vector<StopIndex> marked_stops;
+        std::vector<StopIndex> touched_stops;
+        std::vector<uint32_t> pattern_start_positions;
+        std::vector<PatternIndex> queued_patterns;
+        std::vector<std::pair<double, StopIndex>> walk_heap;
+        std::vector<double> target_times;  // time from a target stop to the end of the journey
+        std::vector<StopIndex> target_stops;
+        double target_bound = INFINITE_TIME;  // best total time over the targets reached so far
+
+        void Prepare(size_t stop_count, size_t pattern_count);
+        void Touch(StopIndex stop);
+        void AddSource(StopIndex stop, double time);
+        void AddTarget(StopIndex stop, double time);
+        void UpdateTargetBound(StopIndex stop);
+    };
+
+    static SearchScratch& GetScratch();
+
+    double bus_wait_time_;
+    std::vector<std::string_view> stop_names_;  // indexed by StopId
+    std::vector<Pattern> patterns_;
+    // For every stop the positions it takes in the patterns, in CSR form
+    std::vector<size_t> stop_pattern_offsets_;
+    std::vector<PatternStop> stop_patterns_;
+    double walking_meters_to_minutes_multiplier_ = 0.0;
+    // Walking transfers from every stop, in CSR form
+    std::vector<size_t> footpath_offsets_;
+    std::vector<Footpath> footpaths_;
+
+    void BuildFootpaths(const TransportCatalogue& tc, const RoutingSettings& routing_settings);
+    void RunRounds(SearchScratch& scratch) const;
+    void RelaxFootpaths(SearchScratch& scratch) const;
+    void ScanPattern(PatternIndex pattern_index, uint32_t start_position, SearchScratch& scratch) const;
+    EndpointsRoute ReconstructRoute(StopIndex to, const SearchScratch& scratch) const;
+};
+}
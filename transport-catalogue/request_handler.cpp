@@ -36,6 +36,13 @@ namespace transport_catalogue {
         
     }
 
+    void RequestHandler::AddBusesToRouter() {
+        for (const auto& bus_num : buses_names_) {
+            transport_router_.AddBus(bus_num);
+        }
+        buses_names_.clear();
+    }
+
     StatResponseDTO RequestHandler::StatRequest(const StatRequestDTO& stat_request_opt) {
         if (!stat_request_opt.has_value()) {
             return std::nullopt;
@@ -47,14 +54,26 @@ namespace transport_catalogue {
             {
             case RequestType::GetStopInfo:
                 return std::tuple{ std::get<int>(stat_request), 
-                    tc_.GetStopInfo(std::get<std::string_view>(request_body.value()))
+                    tc_.GetSnapshot().GetStopInfoView(std::get<std::string_view>(request_body.value()))
                 };
                 break;
             case RequestType::GetBusInfo:
                 return std::tuple{ std::get<int>(stat_request), 
-                    tc_.GetBusInfo(std::get<std::string_view>(request_body.value()))
+                    tc_.GetSnapshot().GetBusInfo(std::get<std::string_view>(request_body.value()))
                 };
                 break;
+            case RequestType::GetDirectBuses: {
+                const auto& [from, to] = std::get<std::tuple<std::string_view,std::string_view>>(request_body.value());
+                return std::tuple{ std::get<int>(stat_request), tc_.GetSnapshot().GetDirectBuses(from, to) };
+            } break;
+            case RequestType::GetNearestStops: {
+                const auto& query = std::get<NearbyStopsQuery>(request_body.value());
+                return std::tuple{ std::get<int>(stat_request), tc_.GetSnapshot().GetNearestStops(query.point, query.count) };
+            } break;
+            case RequestType::GetStopsInRadius: {
+                const auto& query = std::get<NearbyStopsQuery>(request_body.value());
+                return std::tuple{ std::get<int>(stat_request), tc_.GetSnapshot().GetStopsInRadius(query.point, query.radius) };
+            } break;
             case RequestType::GetMap:
                 return std::tuple{ std::get<int>(stat_request), RenderMap() };
                 break;
@@ -63,6 +82,10 @@ namespace transport_catalogue {
                     transport_router_.GetRoute(std::get<std::tuple<std::string_view,std::string_view>>(request_body.value()))
                 };
                 break;
+            case RequestType::GetRouteByCoordinates: {
+                const auto& query = std::get<CoordinatesRouteQuery>(request_body.value());
+                return std::tuple{ std::get<int>(stat_request), transport_router_.GetRoute(query.from, query.to) };
+            } break;
             default:
                 return std::nullopt;
                 break;
@@ -75,8 +98,9 @@ namespace transport_catalogue {
     }
 
     std::string RequestHandler::RenderMap() {
-        for (const auto busnum : tc_.GetBusList()) {
-            renderer_.SetBusExtendedInfo(tc_.GetBusExtendedInfo(busnum));
+        const CatalogueSnapshot& snapshot = tc_.GetSnapshot();
+        for (BusId bus_id = 0; bus_id < snapshot.GetBusCount(); ++bus_id) {
+            renderer_.SetBusExtendedInfo(snapshot.GetBusExtendedInfo(bus_id));
         }   
         std::stringstream ss;
         renderer_.Render(ss);
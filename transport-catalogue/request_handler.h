@@ -25,6 +25,8 @@ namespace transport_catalogue {
             transport_catalogue::TransportRouter& transport_router)
         : tc_(db), renderer_(renderer), transport_router_(transport_router) { }
         void BaseRequest(BaseRequestDTO base_request);
+        // Passes the buses added by base requests so far to a router that is already set up
+        void AddBusesToRouter();
         StatResponseDTO StatRequest(const StatRequestDTO& stat_request);
         void BuildGraph(const RoutingSettings& routing_settings);
     private:
@@ -0,0 +1,88 @@
+#include "road_distances.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace transport_catalogue {
+    using namespace std::string_literals;
+
+    void RoadDistances::Set(StopId from, StopId to, double distance) {
+        staged_distances_[GetStopPairKey(from, to)] = distance;
+    }
+
+    void RoadDistances::SetIfAbsent(StopId from, StopId to, double distance) {
+        if (!Find(from, to)) {
+            staged_distances_.emplace(GetStopPairKey(from, to), distance);
+        }
+    }
+
+    std::optional<double> RoadDistances::Find(StopId from, StopId to) const {
+        if (!staged_distances_.empty()) {
+            const auto it = staged_distances_.find(GetStopPairKey(from, to));
+            if (it != staged_distances_.end()) {
+                return it->second;
+            }
+        }
+        return FindFrozen(from, to);
+    }
+
+    std::optional<double> RoadDistances::FindFrozen(StopId from, StopId to) const {
+        if (static_cast<size_t>(from) + 1 >= offsets_.size()) {
+            return std::nullopt;
+        }
+        const auto begin = neighbours_.begin() + offsets_[from];
+        const auto end = neighbours_.begin() + offsets_[from + 1];
+        const auto it = std::lower_bound(begin, end, to);
+        if (it == end || *it != to) {
+            return std::nullopt;
+        }
+        return distances_[it - neighbours_.begin()];
+    }
+
+    // Staged distances take over the frozen ones of the same pair
+    void RoadDistances::Freeze() {
+        if (IsFrozen()) {
+            return;
+        }
+
+        std::vector<std::pair<uint64_t, double>> pairs;
+        pairs.reserve(neighbours_.size() + staged_distances_.size());
+        for (StopId from = 0; from + 1 < offsets_.size(); ++from) {
+            for (uint32_t i = offsets_[from]; i < offsets_[from + 1]; ++i) {
+                const uint64_t key = GetStopPairKey(from, neighbours_[i]);
+                if (!staged_distances_.count(key)) {
+                    pairs.emplace_back(key, distances_[i]);
+                }
+            }
+        }
+        pairs.insert(pairs.end(), staged_distances_.begin(), staged_distances_.end());
+        std::sort(pairs.begin(), pairs.end());
+
+        if (pairs.size() >= UINT32_MAX) {
+            throw std::overflow_error("Too many road distances"s);
+        }
+
+        const StopId max_from = static_cast<StopId>(pairs.back().first >> 32);
+        offsets_.assign(static_cast<size_t>(max_from) + 2, 0);
+        neighbours_.clear();
+        neighbours_.reserve(pairs.size());
+        distances_.clear();
+        distances_.reserve(pairs.size());
+        for (const auto& [key, distance] : pairs) {
+            ++offsets_[(key >> 32) + 1];
+            neighbours_.push_back(static_cast<StopId>(key));
+            distances_.push_back(distance);
+        }
+        for (size_t from = 1; from < offsets_.size(); ++from) {
+            offsets_[from] += offsets_[from - 1];
+        }
+
+        staged_distances_.clear();
+    }
+
+    bool RoadDistances::IsFrozen() const {
+        return staged_distances_.empty();
+    }
+}
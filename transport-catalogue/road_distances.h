@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "domain.h"
+
+namespace transport_catalogue {
+// Road distances between stops in CSR form: the neighbours of stop s are neighbours_[offsets_[s]..offsets_[s + 1]),
+// sorted by id, with the distances alongside. Distances set while the catalogue is being filled are staged in a
+// hash map and merged into the arrays by Freeze(); lookups see both, so the result doesn't depend on freezing.
+class RoadDistances {
+public:
+    void Set(StopId from, StopId to, double distance);
+    // Keeps the distance already known for the pair, if any
+    void SetIfAbsent(StopId from, StopId to, double distance);
+
+    std::optional<double> Find(StopId from, StopId to) const;
+
+    void Freeze();
+    bool IsFrozen() const;
+
+private:
+    std::vector<uint32_t> offsets_;
+    std::vector<StopId> neighbours_;
+    std::vector<double> distances_;
+
+    std::unordered_map<uint64_t, double> staged_distances_;
+
+    static uint64_t GetStopPairKey(StopId from, StopId to) {
+        return (static_cast<uint64_t>(from) << 32) | to;
+    }
+
+    std::optional<double> FindFrozen(StopId from, StopId to) const;
+};
+}
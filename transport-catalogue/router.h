@@ -1,6 +1,8 @@
 #pragma once
 
 #include "graph.h"
+#include "routes_storage.h"
+#include "thread_pool.h"
 
 #include <algorithm>
 #include <cassert>
@@ -15,109 +17,207 @@
 namespace graph {
 
 template <typename Weight>
+struct RouteInfo {
+    Weight weight;
+    std::vector<EdgeId> edges;
+};
+
+template <typename Weight, typename Storage = FlatRoutesStorage<Weight>>
 class Router {
 private:
     using Graph = DirectedWeightedGraph<Weight>;
 
 public:
-    Router(Graph& graph);
+    using RoutesStorage = Storage;
 
-    struct RouteInfo {
-        Weight weight;
-        std::vector<EdgeId> edges;
-    };
+    explicit Router(Graph& graph, size_t thread_count = parallel::GetDefaultThreadCount());
+    // Takes an already computed table (e.g. loaded from the base) instead of running Floyd-Warshall
+    Router(Graph& graph, RoutesStorage routes_internal_data);
+
+    using RouteInfo = graph::RouteInfo<Weight>;
 
     std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
     void Update();
+    // Brings the table up to date with the vertices and edges added to the graph since it was built,
+    // relaxing all routes through each new edge in O(V^2) instead of rebuilding it in O(V^3).
+    // Edges already in the table are expected to be unchanged.
+    void UpdateWithNewEdges();
+
+    const RoutesStorage& GetRoutesInternalData() const;
 
 private:
-    struct RouteInternalData {
-        Weight weight;
-        std::optional<EdgeId> prev_edge;
-    };
-    using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
 
     void InitializeRoutesInternalData(const Graph& graph) {
         const size_t vertex_count = graph.GetVertexCount();
+        routes_internal_data_.Resize(vertex_count);
         for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-            routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+            routes_internal_data_.Set(vertex, vertex, ZERO_WEIGHT, std::nullopt);
             for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
                 const auto& edge = graph.GetEdge(edge_id);
                 if (edge.weight < ZERO_WEIGHT) {
                     throw std::domain_error("Edges' weights should be non-negative");
                 }
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                    route_internal_data = RouteInternalData{edge.weight, edge_id};
+                if (!routes_internal_data_.IsReachable(vertex, edge.to)
+                    || routes_internal_data_.GetWeight(vertex, edge.to) > edge.weight) {
+                    routes_internal_data_.Set(vertex, edge.to, edge.weight, edge_id);
                 }
             }
         }
     }
 
-    void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from, const RouteInternalData& route_to) {
-        auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-        const Weight candidate_weight = route_from.weight + route_to.weight;
-        if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-            route_relaxing = {candidate_weight,
-                              route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
+    struct VertexRange {
+        VertexId begin;
+        VertexId end;
+    };
+
+    void RelaxTileThroughVertices(VertexRange from_range, VertexRange through_range, VertexRange to_range) {
+        for (VertexId vertex_through = through_range.begin; vertex_through < through_range.end; ++vertex_through) {
+            for (VertexId vertex_from = from_range.begin; vertex_from < from_range.end; ++vertex_from) {
+                routes_internal_data_.RelaxRow(vertex_from, vertex_through, to_range.begin, to_range.end);
+            }
         }
     }
 
-    void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-        for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-            if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                    if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                        RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-                    }
+    // Blocked Floyd-Warshall: for every diagonal tile the tiles of its row and column depend only
+    // on that tile, and all the remaining tiles depend only on the row and the column, so the tiles
+    // of the last two phases are relaxed in parallel.
+    void RelaxRoutesInternalData(size_t vertex_count) {
+        const size_t block_count = (vertex_count + TILE_SIZE - 1) / TILE_SIZE;
+        const auto get_block = [vertex_count](size_t block) {
+            return VertexRange{block * TILE_SIZE, std::min(vertex_count, (block + 1) * TILE_SIZE)};
+        };
+        parallel::ThreadPool thread_pool(std::min(thread_count_, block_count * block_count));
+
+        for (size_t through_block = 0; through_block < block_count; ++through_block) {
+            const VertexRange through_range = get_block(through_block);
+            RelaxTileThroughVertices(through_range, through_range, through_range);
+
+            thread_pool.ParallelFor(2 * (block_count - 1), [&](size_t task) {
+                size_t block = task / 2;
+                if (block >= through_block) {
+                    ++block;
                 }
-            }
+                if (task % 2 == 0) {
+                    RelaxTileThroughVertices(through_range, through_range, get_block(block));
+                } else {
+                    RelaxTileThroughVertices(get_block(block), through_range, through_range);
+                }
+            });
+
+            const size_t other_block_count = block_count - 1;
+            thread_pool.ParallelFor(other_block_count * other_block_count, [&](size_t task) {
+                size_t from_block = task / other_block_count;
+                size_t to_block = task % other_block_count;
+                from_block += from_block >= through_block ? 1 : 0;
+                to_block += to_block >= through_block ? 1 : 0;
+                RelaxTileThroughVertices(get_block(from_block), through_range, get_block(to_block));
+            });
         }
     }
 
+    // A route a -> b improved by the new edge u -> v goes a -> u -> v -> b. Neither a -> u nor v -> b
+    // can use the edge (that would make a cycle), so relaxing the row of u through v and then every
+    // other row through u updates the whole table.
+    void RelaxThroughEdge(EdgeId edge_id, parallel::ThreadPool& thread_pool) {
+        const auto& edge = graph_.GetEdge(edge_id);
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        if (edge.from == edge.to || (routes_internal_data_.IsReachable(edge.from, edge.to)
+                                     && !(edge.weight < routes_internal_data_.GetWeight(edge.from, edge.to)))) {
+            return;
+        }
+        const size_t vertex_count = routes_internal_data_.GetVertexCount();
+        routes_internal_data_.Set(edge.from, edge.to, edge.weight, edge_id);
+        routes_internal_data_.RelaxRow(edge.from, edge.to, 0, vertex_count);
+
+        const size_t block_count = (vertex_count + TILE_SIZE - 1) / TILE_SIZE;
+        thread_pool.ParallelFor(block_count, [&](size_t block) {
+            const VertexId end = std::min(vertex_count, (block + 1) * TILE_SIZE);
+            for (VertexId vertex_from = block * TILE_SIZE; vertex_from < end; ++vertex_from) {
+                if (vertex_from != edge.from) {
+                    routes_internal_data_.RelaxRow(vertex_from, edge.from, 0, vertex_count);
+                }
+            }
+        });
+    }
+
     static constexpr Weight ZERO_WEIGHT{};
+    static constexpr size_t TILE_SIZE = 64;
     Graph& graph_;
-    RoutesInternalData routes_internal_data_;
+    size_t thread_count_ = 1;
+    size_t edge_count_ = 0;  // edges [0, edge_count_) of the graph are accounted for in the table
+    RoutesStorage routes_internal_data_;
 };
 
-template <typename Weight>
-Router<Weight>::Router(Graph& graph)
+template <typename Weight, typename Storage>
+Router<Weight, Storage>::Router(Graph& graph, size_t thread_count)
     : graph_(graph)
-    , routes_internal_data_(graph.GetVertexCount(),
-                            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+    , thread_count_(std::max<size_t>(1, thread_count))
+    , edge_count_(graph.GetEdgeCount())
 {
     InitializeRoutesInternalData(graph);
+    RelaxRoutesInternalData(graph.GetVertexCount());
+}
 
-    const size_t vertex_count = graph.GetVertexCount();
-    for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-        RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+template <typename Weight, typename Storage>
+Router<Weight, Storage>::Router(Graph& graph, RoutesStorage routes_internal_data)
+    : graph_(graph)
+    , thread_count_(parallel::GetDefaultThreadCount())
+    , edge_count_(graph.GetEdgeCount())
+    , routes_internal_data_(std::move(routes_internal_data))
+{
+    if (routes_internal_data_.GetVertexCount() != graph.GetVertexCount()) {
+        throw std::invalid_argument("Routes table doesn't match the graph");
     }
 }
 
-template <typename Weight>
-void Router<Weight>::Update() {
-    routes_internal_data_.resize(graph_.GetVertexCount(),
-                            std::vector<std::optional<RouteInternalData>>(graph_.GetVertexCount()));
+template <typename Weight, typename Storage>
+const typename Router<Weight, Storage>::RoutesStorage& Router<Weight, Storage>::GetRoutesInternalData() const {
+    return routes_internal_data_;
+}
+
+template <typename Weight, typename Storage>
+void Router<Weight, Storage>::Update() {
+    edge_count_ = graph_.GetEdgeCount();
     InitializeRoutesInternalData(graph_);
+    RelaxRoutesInternalData(graph_.GetVertexCount());
+}
 
+template <typename Weight, typename Storage>
+void Router<Weight, Storage>::UpdateWithNewEdges() {
+    const size_t old_vertex_count = routes_internal_data_.GetVertexCount();
     const size_t vertex_count = graph_.GetVertexCount();
-    for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-        RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+    if (vertex_count < old_vertex_count || graph_.GetEdgeCount() < edge_count_) {
+        throw std::logic_error("Routes table is ahead of the graph");
+    }
+    routes_internal_data_.Grow(vertex_count);
+    for (VertexId vertex = old_vertex_count; vertex < vertex_count; ++vertex) {
+        routes_internal_data_.Set(vertex, vertex, ZERO_WEIGHT, std::nullopt);
+    }
+    if (edge_count_ == graph_.GetEdgeCount()) {
+        return;
+    }
+    parallel::ThreadPool thread_pool(std::min(thread_count_, (vertex_count + TILE_SIZE - 1) / TILE_SIZE));
+    for (; edge_count_ < graph_.GetEdgeCount(); ++edge_count_) {
+        RelaxThroughEdge(edge_count_, thread_pool);
     }
 }
 
-template <typename Weight>
-std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from, VertexId to) const {
-    const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-    if (!route_internal_data) {
+template <typename Weight, typename Storage>
+std::optional<typename Router<Weight, Storage>::RouteInfo> Router<Weight, Storage>::BuildRoute(VertexId from, VertexId to) const {
+    if (from >= routes_internal_data_.GetVertexCount() || to >= routes_internal_data_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    if (!routes_internal_data_.IsReachable(from, to)) {
         return std::nullopt;
     }
-    Weight weight = route_internal_data->weight;
+    Weight weight = routes_internal_data_.GetWeight(from, to);
     std::vector<EdgeId> edges;
-    for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
+    for (std::optional<EdgeId> edge_id = routes_internal_data_.GetPrevEdge(from, to);
          edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+         edge_id = routes_internal_data_.GetPrevEdge(from, graph_.GetEdge(*edge_id).from))
     {
         edges.push_back(*edge_id);
     }
@@ -0,0 +1,200 @@
+#pragma once
+
+#include "graph.h"
+#include "min_plus.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Storages of the all-pairs routes table used by Router. Every storage provides:
+//   void Resize(size_t vertex_count);                  // all cells become unreachable
+//   void Grow(size_t vertex_count);                    // keeps the cells, the new ones are unreachable
+//   size_t GetVertexCount() const;
+//   bool IsReachable(VertexId from, VertexId to) const;
+//   Weight GetWeight(VertexId from, VertexId to) const;
+//   std::optional<EdgeId> GetPrevEdge(VertexId from, VertexId to) const;
+//   void Set(VertexId from, VertexId to, Weight weight, std::optional<EdgeId> prev_edge);
+//   void RelaxRow(VertexId from, VertexId through, VertexId to_begin, VertexId to_end);
+// RelaxRow improves routes from -> [to_begin, to_end) with routes going through the vertex `through`.
+
+// The original layout: a separate row vector per vertex, std::optional for unreachable cells.
+template <typename Weight>
+class NestedRoutesStorage {
+public:
+    void Resize(size_t vertex_count) {
+        routes_internal_data_.assign(vertex_count, std::vector<std::optional<RouteInternalData>>(vertex_count));
+    }
+
+    void Grow(size_t vertex_count) {
+        for (auto& row : routes_internal_data_) {
+            row.resize(vertex_count);
+        }
+        routes_internal_data_.resize(vertex_count, std::vector<std::optional<RouteInternalData>>(vertex_count));
+    }
+
+    size_t GetVertexCount() const {
+        return routes_internal_data_.size();
+    }
+
+    bool IsReachable(VertexId from, VertexId to) const {
+        return routes_internal_data_[from][to].has_value();
+    }
+
+    Weight GetWeight(VertexId from, VertexId to) const {
+        return routes_internal_data_[from][to]->weight;
+    }
+
+    std::optional<EdgeId> GetPrevEdge(VertexId from, VertexId to) const {
+        return routes_internal_data_[from][to]->prev_edge;
+    }
+
+    void Set(VertexId from, VertexId to, Weight weight, std::optional<EdgeId> prev_edge) {
+        routes_internal_data_[from][to] = RouteInternalData{weight, prev_edge};
+    }
+
+    void RelaxRow(VertexId from, VertexId through, VertexId to_begin, VertexId to_end) {
+        const auto& route_from = routes_internal_data_[from][through];
+        if (!route_from) {
+            return;
+        }
+        for (VertexId to = to_begin; to < to_end; ++to) {
+            if (const auto& route_to = routes_internal_data_[through][to]) {
+                auto& route_relaxing = routes_internal_data_[from][to];
+                const Weight candidate_weight = route_from->weight + route_to->weight;
+                if (!route_relaxing || candidate_weight < route_relaxing->weight) {
+                    route_relaxing = {candidate_weight,
+                                      route_to->prev_edge ? route_to->prev_edge : route_from->prev_edge};
+                }
+            }
+        }
+    }
+
+private:
+    struct RouteInternalData {
+        Weight weight;
+        std::optional<EdgeId> prev_edge;
+    };
+
+    std::vector<std::vector<std::optional<RouteInternalData>>> routes_internal_data_;
+};
+
+// One contiguous row-major buffer per field. Unreachable cells hold an infinite weight, cells
+// without a previous edge hold NO_EDGE. StoredWeight may be narrower than Weight (e.g. float)
+// to halve the table size at the cost of precision.
+template <typename Weight, typename StoredWeight = Weight>
+class FlatRoutesStorage {
+public:
+    static_assert(std::numeric_limits<StoredWeight>::has_infinity, "Stored weight should have an infinity");
+
+    static constexpr StoredWeight INFINITE_WEIGHT = std::numeric_limits<StoredWeight>::infinity();
+    static constexpr uint32_t NO_EDGE = std::numeric_limits<uint32_t>::max();
+
+    FlatRoutesStorage() = default;
+    // Takes the buffers as they are laid out here, e.g. read from the base
+    FlatRoutesStorage(size_t vertex_count, std::vector<StoredWeight> weights, std::vector<uint32_t> prev_edges)
+        : vertex_count_(vertex_count)
+        , weights_(std::move(weights))
+        , prev_edges_(std::move(prev_edges))
+    {
+        if (weights_.size() != vertex_count * vertex_count || prev_edges_.size() != vertex_count * vertex_count) {
+            throw std::invalid_argument("Routes table size doesn't match the vertex count");
+        }
+    }
+
+    void Resize(size_t vertex_count) {
+        vertex_count_ = vertex_count;
+        weights_.assign(vertex_count * vertex_count, INFINITE_WEIGHT);
+        prev_edges_.assign(vertex_count * vertex_count, NO_EDGE);
+    }
+
+    void Grow(size_t vertex_count) {
+        if (vertex_count <= vertex_count_) {
+            return;
+        }
+        std::vector<StoredWeight> weights(vertex_count * vertex_count, INFINITE_WEIGHT);
+        std::vector<uint32_t> prev_edges(vertex_count * vertex_count, NO_EDGE);
+        for (VertexId from = 0; from < vertex_count_; ++from) {
+            std::copy_n(weights_.begin() + from * vertex_count_, vertex_count_, weights.begin() + from * vertex_count);
+            std::copy_n(prev_edges_.begin() + from * vertex_count_, vertex_count_, prev_edges.begin() + from * vertex_count);
+        }
+        vertex_count_ = vertex_count;
+        weights_ = std::move(weights);
+        prev_edges_ = std::move(prev_edges);
+    }
+
+    size_t GetVertexCount() const {
+        return vertex_count_;
+    }
+
+    const std::vector<StoredWeight>& GetWeights() const {
+        return weights_;
+    }
+
+    const std::vector<uint32_t>& GetPrevEdges() const {
+        return prev_edges_;
+    }
+
+    bool IsReachable(VertexId from, VertexId to) const {
+        return weights_[from * vertex_count_ + to] != INFINITE_WEIGHT;
+    }
+
+    Weight GetWeight(VertexId from, VertexId to) const {
+        return static_cast<Weight>(weights_[from * vertex_count_ + to]);
+    }
+
+    std::optional<EdgeId> GetPrevEdge(VertexId from, VertexId to) const {
+        const uint32_t prev_edge = prev_edges_[from * vertex_count_ + to];
+        if (prev_edge == NO_EDGE) {
+            return std::nullopt;
+        }
+        return prev_edge;
+    }
+
+    void Set(VertexId from, VertexId to, Weight weight, std::optional<EdgeId> prev_edge) {
+        if (prev_edge && *prev_edge >= NO_EDGE) {
+            throw std::overflow_error("Edge id doesn't fit the routes table");
+        }
+        weights_[from * vertex_count_ + to] = static_cast<StoredWeight>(weight);
+        prev_edges_[from * vertex_count_ + to] = prev_edge ? static_cast<uint32_t>(*prev_edge) : NO_EDGE;
+    }
+
+    // The diagonal cell of `through` has zero weight, so the cell it could update never improves;
+    // that is why the previous edge can always be taken from the `through` row.
+    void RelaxRow(VertexId from, VertexId through, VertexId to_begin, VertexId to_end) {
+        const StoredWeight weight_from = weights_[from * vertex_count_ + through];
+        if (weight_from == INFINITE_WEIGHT) {
+            return;
+        }
+        StoredWeight* weights = weights_.data() + from * vertex_count_;
+        uint32_t* prev_edges = prev_edges_.data() + from * vertex_count_;
+        const StoredWeight* weights_through = weights_.data() + through * vertex_count_;
+        const uint32_t* prev_edges_through = prev_edges_.data() + through * vertex_count_;
+        if constexpr (std::is_same_v<StoredWeight, double> || std::is_same_v<StoredWeight, float>) {
+            RelaxRowMinPlus(weight_from, weights_through + to_begin, prev_edges_through + to_begin,
+                            weights + to_begin, prev_edges + to_begin, to_end - to_begin);
+        } else {
+            for (VertexId to = to_begin; to < to_end; ++to) {
+                const StoredWeight candidate_weight = weight_from + weights_through[to];
+                if (candidate_weight < weights[to]) {
+                    weights[to] = candidate_weight;
+                    prev_edges[to] = prev_edges_through[to];
+                }
+            }
+        }
+    }
+
+private:
+    size_t vertex_count_ = 0;
+    std::vector<StoredWeight> weights_;
+    std::vector<uint32_t> prev_edges_;
+};
+
+}  // namespace graph
@@ -1,32 +1,239 @@
 #include "serialization.h"
 #include "graph.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
 namespace transport_catalogue {
     using namespace std::string_literals;
 
+    namespace {
+        // The base is a little-endian uint64 size of the message followed by the message itself and then
+        // by the all-pairs routes table. The table is kept out of the message, since protobuf can't handle
+        // messages over 2 GB: it is a little-endian uint64 vertex count (NO_ROUTES_TABLE if there is no table),
+        // two little-endian uint64 widths in bytes of a stored weight and of a prev edge id, then the row-major
+        // weights as little-endian floating point numbers of the storage, unreachable cells infinite, and then
+        // the row-major prev edge ids as little-endian unsigned integers, NO_EDGE for none. Hub labels, if the message
+        // has them, come next, outgoing then incoming: vertex_count + 1 little-endian uint64 offsets and then
+        // the entries, each a uint32 hub rank, a uint32 via edge and a double weight, all little-endian. Both
+        // arrays start at a multiple of ARRAY_ALIGNMENT from the beginning of the base, so the labels can be
+        // used right from a mapped file.
+        using RoutesStorage = graph::Router<double>::RoutesStorage;
+        using StoredWeight = std::decay_t<decltype(std::declval<const RoutesStorage&>().GetWeights())>::value_type;
+        using StoredPrevEdge = std::decay_t<decltype(std::declval<const RoutesStorage&>().GetPrevEdges())>::value_type;
+        static_assert(std::is_floating_point_v<StoredWeight> && std::is_unsigned_v<StoredPrevEdge>,
+                      "the routes table is stored as floating point weights and unsigned edge ids");
+        constexpr size_t SIZE_FIELD_SIZE = sizeof(uint64_t);
+        constexpr uint64_t NO_ROUTES_TABLE = std::numeric_limits<uint64_t>::max();
+        constexpr size_t ARRAY_CHUNK_SIZE = 1 << 16;
+        constexpr size_t ARRAY_ALIGNMENT = 8;
+
+        using HubLabelSet = graph::HubLabels<double>::LabelSet;
+        using HubLabelEntry = graph::HubLabels<double>::LabelEntry;
+        static_assert(sizeof(HubLabelEntry) == 2 * sizeof(uint32_t) + sizeof(double) && std::is_trivially_copyable_v<HubLabelEntry>,
+                      "hub label entries are stored as they are in memory");
+
+        void WriteLittleEndian(char* out, uint64_t value, size_t size) {
+            for (size_t i = 0; i < size; ++i) {
+                out[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+            }
+        }
+
+        uint64_t ReadLittleEndian(const char* in, size_t size) {
+            uint64_t value = 0;
+            for (size_t i = 0; i < size; ++i) {
+                value |= static_cast<uint64_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+            }
+            return value;
+        }
+
+        void WriteSizeField(std::ostream& output, uint64_t value) {
+            char bytes[SIZE_FIELD_SIZE];
+            WriteLittleEndian(bytes, value, SIZE_FIELD_SIZE);
+            output.write(bytes, SIZE_FIELD_SIZE);
+        }
+
+        uint64_t ReadSizeField(std::istream& input) {
+            char bytes[SIZE_FIELD_SIZE];
+            if (!input.read(bytes, SIZE_FIELD_SIZE)) {
+                throw std::invalid_argument("base is truncated"s);
+            }
+            return ReadLittleEndian(bytes, SIZE_FIELD_SIZE);
+        }
+
+        bool IsLittleEndianHost() {
+            const uint16_t value = 1;
+            unsigned char first_byte;
+            std::memcpy(&first_byte, &value, 1);
+            return first_byte == 1;
+        }
+
+        template <typename T>
+        void ReverseBytes(T* values, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                auto* bytes = reinterpret_cast<unsigned char*>(values + i);
+                std::reverse(bytes, bytes + sizeof(T));
+            }
+        }
+
+        void ReverseBytes(HubLabelEntry* entries, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                ReverseBytes(&entries[i].hub, 1);
+                ReverseBytes(&entries[i].via_edge, 1);
+                ReverseBytes(&entries[i].weight, 1);
+            }
+        }
+
+        void WritePadding(std::ostream& output) {
+            const std::streamoff position = output.tellp();
+            if (position < 0) {
+                throw std::runtime_error("can't write the base"s);
+            }
+            const char zeros[ARRAY_ALIGNMENT] = {};
+            output.write(zeros, static_cast<std::streamsize>((ARRAY_ALIGNMENT - position % ARRAY_ALIGNMENT) % ARRAY_ALIGNMENT));
+        }
+
+        void SkipPadding(std::istream& input) {
+            const std::streamoff position = input.tellg();
+            if (position < 0) {
+                throw std::invalid_argument("can't read the base"s);
+            }
+            const std::streamsize padding = static_cast<std::streamsize>((ARRAY_ALIGNMENT - position % ARRAY_ALIGNMENT) % ARRAY_ALIGNMENT);
+            if (!input.ignore(padding) || input.gcount() != padding) {
+                throw std::invalid_argument("base is truncated"s);
+            }
+        }
+
+        // Arrays of numbers go as they are on little-endian hosts, otherwise chunk by chunk with the bytes reversed
+        template <typename T>
+        void WriteArray(std::ostream& output, const std::vector<T>& values) {
+            if (IsLittleEndianHost()) {
+                output.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+                return;
+            }
+            std::vector<T> chunk;
+            for (size_t begin = 0; begin < values.size(); begin += ARRAY_CHUNK_SIZE) {
+                chunk.assign(values.begin() + begin, values.begin() + std::min(values.size(), begin + ARRAY_CHUNK_SIZE));
+                ReverseBytes(chunk.data(), chunk.size());
+                output.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size() * sizeof(T)));
+            }
+        }
+
+        template <typename T>
+        std::vector<T> ReadArray(std::istream& input, size_t count) {
+            std::vector<T> values(count);
+            if (!input.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(count * sizeof(T)))) {
+                throw std::invalid_argument("base is truncated"s);
+            }
+            if (!IsLittleEndianHost()) {
+                ReverseBytes(values.data(), values.size());
+            }
+            return values;
+        }
+
+        void WriteRoutesTable(std::ostream& output, const RoutesStorage* routes_internal_data) {
+            if (!routes_internal_data) {
+                WriteSizeField(output, NO_ROUTES_TABLE);
+                return;
+            }
+            WriteSizeField(output, routes_internal_data->GetVertexCount());
+            WriteSizeField(output, sizeof(StoredWeight));
+            WriteSizeField(output, sizeof(StoredPrevEdge));
+            WriteArray(output, routes_internal_data->GetWeights());
+            WriteArray(output, routes_internal_data->GetPrevEdges());
+        }
+
+        // Read straight into the buffers of the table, so nothing else of its size is held
+        std::optional<RoutesStorage> ReadRoutesTable(std::istream& input) {
+            const uint64_t vertex_count = ReadSizeField(input);
+            if (vertex_count == NO_ROUTES_TABLE) {
+                return std::nullopt;
+            }
+            if (vertex_count > std::numeric_limits<uint32_t>::max()) {
+                throw std::invalid_argument("routes table is corrupted"s);
+            }
+            const uint64_t weight_width = ReadSizeField(input);
+            const uint64_t prev_edge_width = ReadSizeField(input);
+            if (weight_width != sizeof(StoredWeight) || prev_edge_width != sizeof(StoredPrevEdge)) {
+                throw std::invalid_argument("routes table was written with other value widths"s);
+            }
+            const size_t cell_count = static_cast<size_t>(vertex_count * vertex_count);
+            auto weights = ReadArray<StoredWeight>(input, cell_count);
+            auto prev_edges = ReadArray<StoredPrevEdge>(input, cell_count);
+            return RoutesStorage(vertex_count, std::move(weights), std::move(prev_edges));
+        }
+
+        void WriteHubLabelSet(std::ostream& output, const HubLabelSet& labels) {
+            WritePadding(output);
+            WriteArray(output, labels.offsets);
+            WritePadding(output);
+            WriteArray(output, labels.entries);
+        }
+
+        HubLabelSet ReadHubLabelSet(std::istream& input, uint64_t vertex_count, uint64_t entry_count) {
+            if (vertex_count >= std::numeric_limits<uint32_t>::max() || entry_count > std::numeric_limits<size_t>::max() / sizeof(HubLabelEntry)) {
+                throw std::invalid_argument("hub labels are corrupted"s);
+            }
+            HubLabelSet labels;
+            SkipPadding(input);
+            labels.offsets = ReadArray<uint64_t>(input, static_cast<size_t>(vertex_count + 1));
+            SkipPadding(input);
+            labels.entries = ReadArray<HubLabelEntry>(input, static_cast<size_t>(entry_count));
+            return labels;
+        }
+    }
+
     void TransportCatalogueSerializer::SerializeToOstream(std::ostream& output) {
         SerializeTransportCatalogue();
         SerializeRenderer();
         SerializeTransportRouter();
-        tc_ser_.SerializeToOstream(&output);
+
+        WriteSizeField(output, tc_ser_.ByteSizeLong());
+        if (!tc_ser_.SerializeToOstream(&output)) {
+            throw std::runtime_error("can't write the base"s);
+        }
+        WriteRoutesTable(output, transport_router_.GetRoutesInternalData());
+        if (const auto* hub_labels = transport_router_.GetHubLabels()) {
+            WriteHubLabelSet(output, hub_labels->GetOutgoingLabels());
+            WriteHubLabelSet(output, hub_labels->GetIncomingLabels());
+        }
+        if (!output.flush()) {
+            throw std::runtime_error("can't write the base"s);
+        }
     }
 
     void TransportCatalogueSerializer::DeserializeFromIstream(std::istream& input) {
-        tc_ser_.ParseFromIstream(&input);
+        const uint64_t message_size = ReadSizeField(input);
+        if (message_size > static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+            throw std::invalid_argument("base is corrupted"s);
+        }
+        std::string message(static_cast<size_t>(message_size), '\0');
+        if (!input.read(message.data(), static_cast<std::streamsize>(message.size())) || !tc_ser_.ParseFromString(message)) {
+            throw std::invalid_argument("can't read the base"s);
+        }
+        message = std::string{};
+        RawSections raw_sections;
+        raw_sections.routes_internal_data = ReadRoutesTable(input);
+        if (tc_ser_.router().has_hub_labels()) {
+            const uint64_t vertex_count = tc_ser_.router().graph().vertex_count();
+            raw_sections.outgoing_labels = ReadHubLabelSet(input, vertex_count, tc_ser_.router().hub_labels().outgoing_entry_count());
+            raw_sections.incoming_labels = ReadHubLabelSet(input, vertex_count, tc_ser_.router().hub_labels().incoming_entry_count());
+        }
 
         DeserializeTransportCatalogue();
         DeserializeRenderer();
-        DeserializeTransportRouter();
+        DeserializeTransportRouter(std::move(raw_sections));
     }
 
+    // Stops and buses are stored in the order of their ids, so ids survive deserialization
     void TransportCatalogueSerializer::SerializeTransportCatalogue() {
-        std::unordered_map<std::string, uint32_t> stop_name_to_stop_id;
-        uint32_t stop_id = 0;
-        for (std::string_view stop_name : tc_.GetStopList()) {
-            stop_name_to_stop_id[std::string(stop_name)] = stop_id++;
-        }
-        for (std::string_view stop_name : tc_.GetStopList()) {
-            const Stop stop = tc_.FindStop(stop_name);
+        for (StopId stop_id = 0; stop_id < tc_.GetStopCount(); ++stop_id) {
+            const Stop& stop = tc_.GetStop(stop_id);
 
             transport_catalogue_serialize::Stop stop_ser;
 
@@ -36,7 +243,7 @@ namespace transport_catalogue {
 
             for (const auto& [another_stop_name, distance] : stop.range_to_other_stop) {
                 transport_catalogue_serialize::StopIdAndDistancePair pair;
-                pair.set_key(stop_name_to_stop_id.at(another_stop_name));
+                pair.set_key(tc_.GetStopId(another_stop_name));
                 pair.set_value(distance);
 
                 *stop_ser.add_another_stop_id_to_distance() = pair;
@@ -48,21 +255,32 @@ namespace transport_catalogue {
         }
 
 
-        for (const std::string_view bus_name : tc_.GetBusList()) {
-            const Bus bus = tc_.FindBus(bus_name);
+        for (BusId bus_id = 0; bus_id < tc_.GetBusCount(); ++bus_id) {
+            const BusRoute& bus = tc_.GetBus(bus_id);
 
             transport_catalogue_serialize::Bus bus_ser;
 
             bus_ser.set_name(bus.num);
             bus_ser.set_is_circular_route(bus.is_circular_route);
 
-            for (const auto& stop_name : bus.stopnames) {
-                bus_ser.add_stop_id(stop_name_to_stop_id.at(stop_name));
+            for (const StopId stop_id : bus.stop_ids) {
+                bus_ser.add_stop_id(stop_id);
             }
 
             *tc_ser_.add_bus() = bus_ser;
             bus_ser.Clear();
         }
+
+        const SpatialGrid& spatial_grid = tc_.GetSnapshot().GetSpatialGrid();
+        auto* spatial_grid_ser = tc_ser_.mutable_spatial_grid();
+        spatial_grid_ser->set_min_lat(spatial_grid.GetGeometry().min_lat);
+        spatial_grid_ser->set_min_lng(spatial_grid.GetGeometry().min_lng);
+        spatial_grid_ser->set_lat_step(spatial_grid.GetGeometry().lat_step);
+        spatial_grid_ser->set_lng_step(spatial_grid.GetGeometry().lng_step);
+        spatial_grid_ser->set_rows(spatial_grid.GetGeometry().rows);
+        spatial_grid_ser->set_cols(spatial_grid.GetGeometry().cols);
+        *spatial_grid_ser->mutable_cell_offsets() = { spatial_grid.GetCellOffsets().begin(), spatial_grid.GetCellOffsets().end() };
+        *spatial_grid_ser->mutable_stop_ids() = { spatial_grid.GetStopIds().begin(), spatial_grid.GetStopIds().end() };
     }
 
     void TransportCatalogueSerializer::SerializeRenderer() {
@@ -91,6 +309,13 @@ namespace transport_catalogue {
         const RoutingSettings routing_settins = transport_router_.GetRoutingSettings();
         tc_ser_.mutable_router()->mutable_routing_settings()->set_bus_velocity(routing_settins.bus_velocity);
         tc_ser_.mutable_router()->mutable_routing_settings()->set_bus_wait_time(routing_settins.bus_wait_time);
+        tc_ser_.mutable_router()->mutable_routing_settings()->set_router_engine(
+            static_cast<transport_catalogue_serialize::RouterEngine>(routing_settins.router_engine));
+        tc_ser_.mutable_router()->mutable_routing_settings()->set_graph_model(
+            static_cast<transport_catalogue_serialize::GraphModel>(routing_settins.graph_model));
+        tc_ser_.mutable_router()->mutable_routing_settings()->set_walking_velocity(routing_settins.walking_velocity);
+        tc_ser_.mutable_router()->mutable_routing_settings()->set_walking_radius(routing_settins.walking_radius);
+        tc_ser_.mutable_router()->mutable_routing_settings()->set_walking_transfer_radius(routing_settins.walking_transfer_radius);
         transport_catalogue_serialize::Edge edge_ser;
         transport_catalogue_serialize::Graph graph_ser;
         for (graph::EdgeId i = 0; i < transport_router_.GetGraph().GetEdgeCount(); ++i) {
@@ -102,41 +327,71 @@ namespace transport_catalogue {
             *graph_ser.add_edge() = edge_ser;
             edge_ser.Clear();
         }
+        graph_ser.set_vertex_count(transport_router_.GetGraph().GetVertexCount());
         *tc_ser_.mutable_router()->mutable_graph() = graph_ser;
         transport_catalogue_serialize::StopnameAndStopItemPairPair stopname_to_stop_item_pair_pair_ser;
-        for (const auto& [key, value] : transport_router_.GetStopNameToVertexIdPair()) {
-            stopname_to_stop_item_pair_pair_ser.set_key(std::string(key));
-            stopname_to_stop_item_pair_pair_ser.mutable_value()->set_wait_on_stop_id(value.wait_on_stop_id);
-            stopname_to_stop_item_pair_pair_ser.mutable_value()->set_stop_id(value.stop_id);
+        const auto& stop_vertices = transport_router_.GetStopVertices();
+        for (StopId stop_id = 0; stop_id < stop_vertices.size(); ++stop_id) {
+            if (!stop_vertices[stop_id]) {
+                continue;
+            }
+            stopname_to_stop_item_pair_pair_ser.set_key(tc_.GetStop(stop_id).name);
+            stopname_to_stop_item_pair_pair_ser.mutable_value()->set_wait_on_stop_id(stop_vertices[stop_id]->wait_on_stop_id);
+            stopname_to_stop_item_pair_pair_ser.mutable_value()->set_stop_id(stop_vertices[stop_id]->stop_id);
 
             *tc_ser_.mutable_router()->add_stopname_to_vertex_id_pair() = stopname_to_stop_item_pair_pair_ser;
             stopname_to_stop_item_pair_pair_ser.Clear();
         }
-        transport_catalogue_serialize::EdgeIdAndRouteItemPair edge_id_and_route_item_pair_ser;
-        for (const auto& [key, value] : transport_router_.GetEdgeIdToRouteItem()) {
-            edge_id_and_route_item_pair_ser.set_key(key);
-            transport_catalogue_serialize::RouteItem route_item_ser;
-            if (std::holds_alternative<WaitItem>(value)) {
-                const auto& wait_item = std::get<WaitItem>(value);
-                route_item_ser.mutable_wait_item()->set_stop_name(wait_item.stop_name);
-                route_item_ser.mutable_wait_item()->set_time(wait_item.time);
-            } else if (std::holds_alternative<BusItem>(value)) {
-                const auto& bus_item = std::get<BusItem>(value);
-                route_item_ser.mutable_bus_item()->set_bus_name(bus_item.bus);
-                route_item_ser.mutable_bus_item()->set_span_count(bus_item.span_count);
-                route_item_ser.mutable_bus_item()->set_time(bus_item.time);
-            }
-            *edge_id_and_route_item_pair_ser.mutable_value() = route_item_ser;
-            *tc_ser_.mutable_router()->add_edge_id_to_route_item() = edge_id_and_route_item_pair_ser;
-            edge_id_and_route_item_pair_ser.Clear();
+        auto* edge_infos_ser = tc_ser_.mutable_router()->mutable_edge_infos();
+        const auto& edge_infos = transport_router_.GetEdgeInfos();
+        edge_infos_ser->mutable_kind()->Reserve(edge_infos.size());
+        edge_infos_ser->mutable_name_id()->Reserve(edge_infos.size());
+        edge_infos_ser->mutable_span_count()->Reserve(edge_infos.size());
+        for (const auto& edge_info : edge_infos) {
+            edge_infos_ser->add_kind(static_cast<transport_catalogue_serialize::EdgeKind>(edge_info.kind));
+            edge_infos_ser->add_name_id(edge_info.name_id);
+            edge_infos_ser->add_span_count(edge_info.span_count);
+        }
+        if (const auto* landmarks = transport_router_.GetLandmarks()) {
+            auto* landmarks_ser = tc_ser_.mutable_router()->mutable_landmarks();
+            for (graph::VertexId landmark : landmarks->GetLandmarks()) {
+                landmarks_ser->add_vertex(landmark);
+            }
+            *landmarks_ser->mutable_weight_from_landmark() = { landmarks->GetWeightsFromLandmarks().begin(), landmarks->GetWeightsFromLandmarks().end() };
+            *landmarks_ser->mutable_weight_to_landmark() = { landmarks->GetWeightsToLandmarks().begin(), landmarks->GetWeightsToLandmarks().end() };
+        }
+        if (const auto* hub_labels = transport_router_.GetHubLabels()) {
+            auto* hub_labels_ser = tc_ser_.mutable_router()->mutable_hub_labels();
+            for (graph::VertexId vertex : hub_labels->GetVerticesByRank()) {
+                hub_labels_ser->add_vertex_by_rank(vertex);
+            }
+            hub_labels_ser->set_outgoing_entry_count(hub_labels->GetOutgoingLabels().entries.size());
+            hub_labels_ser->set_incoming_entry_count(hub_labels->GetIncomingLabels().entries.size());
+        }
+        if (const auto* contraction_hierarchy = transport_router_.GetContractionHierarchy()) {
+            auto* contraction_hierarchy_ser = tc_ser_.mutable_router()->mutable_contraction_hierarchy();
+            for (uint32_t rank : contraction_hierarchy->GetRanks()) {
+                contraction_hierarchy_ser->add_rank(rank);
+            }
+            for (const auto& shortcut : contraction_hierarchy->GetShortcuts()) {
+                auto* shortcut_ser = contraction_hierarchy_ser->add_shortcut();
+                shortcut_ser->set_from(shortcut.from);
+                shortcut_ser->set_to(shortcut.to);
+                shortcut_ser->set_weight(shortcut.weight);
+                shortcut_ser->set_first(shortcut.first);
+                shortcut_ser->set_second(shortcut.second);
+            }
         }
     }
 
+    // All the stops are added before any distance, otherwise a distance to a stop further in the list
+    // would add that stop ahead of its turn and shift the ids
     void TransportCatalogueSerializer::DeserializeTransportCatalogue() {
-        std::unordered_map<uint32_t, std::string> stop_id_to_stop_name;
-        uint32_t stop_id = 0;
         for (const auto& s : tc_ser_.stop()) {
-            stop_id_to_stop_name[stop_id++] = s.name();
+            Stop stop;
+            stop.name = s.name();
+            stop.coords = { s.coords().lat(), s.coords().lon() };
+            tc_.AddStop(stop);
         }
         for (const auto& s : tc_ser_.stop()) {
             Stop stop;
@@ -144,7 +399,7 @@ namespace transport_catalogue {
             stop.coords = { s.coords().lat(), s.coords().lon() };
 
             for (const auto& as : s.another_stop_id_to_distance()) {
-                stop.range_to_other_stop[stop_id_to_stop_name.at(as.key())] = as.value();
+                stop.range_to_other_stop[tc_ser_.stop(as.key()).name()] = as.value();
             }
 
             tc_.AddStop(stop);
@@ -163,6 +418,28 @@ namespace transport_catalogue {
 
             tc_.AddBus(bus);
         }
+
+        // Bases made before the grid was stored get a new one on freeze
+        if (tc_ser_.has_spatial_grid()) {
+            const auto& spatial_grid_ser = tc_ser_.spatial_grid();
+            SpatialGrid::Geometry geometry;
+            geometry.min_lat = spatial_grid_ser.min_lat();
+            geometry.min_lng = spatial_grid_ser.min_lng();
+            geometry.lat_step = spatial_grid_ser.lat_step();
+            geometry.lng_step = spatial_grid_ser.lng_step();
+            geometry.rows = spatial_grid_ser.rows();
+            geometry.cols = spatial_grid_ser.cols();
+
+            std::vector<geo::Coordinates> stop_coords;
+            stop_coords.reserve(tc_.GetStopCount());
+            for (StopId stop_id = 0; stop_id < tc_.GetStopCount(); ++stop_id) {
+                stop_coords.push_back(tc_.GetStop(stop_id).coords);
+            }
+            tc_.SetSpatialGrid(SpatialGrid(stop_coords, geometry,
+                { spatial_grid_ser.cell_offsets().begin(), spatial_grid_ser.cell_offsets().end() },
+                { spatial_grid_ser.stop_ids().begin(), spatial_grid_ser.stop_ids().end() }));
+        }
+        tc_.Freeze();
     }
 
     void TransportCatalogueSerializer::DeserializeRenderer() {
@@ -191,30 +468,67 @@ namespace transport_catalogue {
         map_renderer_.SetUp(renderer_settings);
     }
 
-    void TransportCatalogueSerializer::DeserializeTransportRouter() {
+    void TransportCatalogueSerializer::DeserializeTransportRouter(RawSections raw_sections) {
         RoutingSettings routing_settings;
         routing_settings.bus_velocity = tc_ser_.router().routing_settings().bus_velocity();
         routing_settings.bus_wait_time = tc_ser_.router().routing_settings().bus_wait_time();
+        routing_settings.router_engine = static_cast<RouterEngine>(tc_ser_.router().routing_settings().router_engine());
+        routing_settings.graph_model = static_cast<GraphModel>(tc_ser_.router().routing_settings().graph_model());
+        routing_settings.walking_velocity = tc_ser_.router().routing_settings().walking_velocity();
+        routing_settings.walking_radius = tc_ser_.router().routing_settings().walking_radius();
+        routing_settings.walking_transfer_radius = tc_ser_.router().routing_settings().walking_transfer_radius();
         transport_router_.SetRoutingSettings(routing_settings);
-        transport_router_.GetGraph().SetVertexCount(tc_ser_.stop_size() * 2); // todo: upd
+        transport_router_.GetGraph().SetVertexCount(tc_ser_.router().graph().vertex_count());
         for (const auto& item : tc_ser_.router().graph().edge()) {
             graph::Edge<double> edge = { item.from(), item.to(), item.weight() };
             transport_router_.GetGraph().AddEdge(edge);
         }
-        transport_router_.UpdateRouter();
-        std::map<std::string, TransportRouter::StopItemPair> stopname_to_vertex_id_pair;
+        std::vector<std::optional<TransportRouter::StopItemPair>> stop_vertices(tc_.GetStopCount());
         for (const auto& item : tc_ser_.router().stopname_to_vertex_id_pair()) {
-            stopname_to_vertex_id_pair.insert({ item.key(), TransportRouter::StopItemPair{ item.value().wait_on_stop_id(), item.value().stop_id() }});
+            stop_vertices[tc_.GetStopId(item.key())] = TransportRouter::StopItemPair{ item.value().wait_on_stop_id(), item.value().stop_id() };
+        }
+        transport_router_.SetStopVertices(std::move(stop_vertices));
+        const auto& edge_infos_ser = tc_ser_.router().edge_infos();
+        if (edge_infos_ser.name_id_size() != edge_infos_ser.kind_size() || edge_infos_ser.span_count_size() != edge_infos_ser.kind_size()) {
+            throw std::invalid_argument("edge infos are inconsistent"s);
         }
-        transport_router_.SetStopnameToVertexIdPair(stopname_to_vertex_id_pair);
-        std::map<graph::VertexId, RouteItem> edge_id_to_route_item;
-        for (const auto& item : tc_ser_.router().edge_id_to_route_item()) {
-            if (item.value().has_wait_item()) {
-                edge_id_to_route_item.insert({ item.key(), WaitItem{ item.value().wait_item().stop_name(), item.value().wait_item().time() }});
-            } else if (item.value().has_bus_item()) {
-                edge_id_to_route_item.insert({ item.key(), BusItem{ item.value().bus_item().bus_name(), item.value().bus_item().span_count(), item.value().bus_item().time() }});
+        std::vector<TransportRouter::EdgeInfo> edge_infos(edge_infos_ser.kind_size());
+        for (int i = 0; i < edge_infos_ser.kind_size(); ++i) {
+            edge_infos[i] = { static_cast<TransportRouter::EdgeKind>(edge_infos_ser.kind(i)), edge_infos_ser.name_id(i), edge_infos_ser.span_count(i) };
+        }
+        transport_router_.SetEdgeInfos(std::move(edge_infos));
+        std::optional<RoutesStorage>& routes_internal_data = raw_sections.routes_internal_data;
+        if (routing_settings.router_engine == RouterEngine::AllPairs && routes_internal_data) {
+            const size_t edge_count = transport_router_.GetGraph().GetEdgeCount();
+            for (const StoredPrevEdge prev_edge : routes_internal_data->GetPrevEdges()) {
+                if (prev_edge != RoutesStorage::NO_EDGE && prev_edge >= edge_count) {
+                    throw std::invalid_argument("routes table doesn't match the graph"s);
+                }
+            }
+            transport_router_.SetRoutesInternalData(std::move(*routes_internal_data));
+        } else if (routing_settings.router_engine == RouterEngine::ContractionHierarchy && tc_ser_.router().has_contraction_hierarchy()) {
+            const auto& contraction_hierarchy_ser = tc_ser_.router().contraction_hierarchy();
+            std::vector<uint32_t> ranks(contraction_hierarchy_ser.rank().begin(), contraction_hierarchy_ser.rank().end());
+            std::vector<graph::ContractionHierarchy<double>::Shortcut> shortcuts;
+            shortcuts.reserve(contraction_hierarchy_ser.shortcut_size());
+            for (const auto& item : contraction_hierarchy_ser.shortcut()) {
+                shortcuts.push_back({ item.from(), item.to(), item.weight(), item.first(), item.second() });
             }
+            transport_router_.SetContractionHierarchy(std::move(ranks), std::move(shortcuts));
+        } else if (routing_settings.router_engine == RouterEngine::HubLabels && raw_sections.outgoing_labels && raw_sections.incoming_labels) {
+            const auto& hub_labels_ser = tc_ser_.router().hub_labels();
+            transport_router_.SetHubLabels(
+                { hub_labels_ser.vertex_by_rank().begin(), hub_labels_ser.vertex_by_rank().end() },
+                std::move(*raw_sections.outgoing_labels),
+                std::move(*raw_sections.incoming_labels));
+        } else if (routing_settings.router_engine == RouterEngine::Alt && tc_ser_.router().has_landmarks()) {
+            const auto& landmarks_ser = tc_ser_.router().landmarks();
+            transport_router_.SetLandmarks(
+                { landmarks_ser.vertex().begin(), landmarks_ser.vertex().end() },
+                { landmarks_ser.weight_from_landmark().begin(), landmarks_ser.weight_from_landmark().end() },
+                { landmarks_ser.weight_to_landmark().begin(), landmarks_ser.weight_to_landmark().end() });
+        } else {
+            transport_router_.UpdateRouter();
         }
-        transport_router_.SetEdgeIdToRouteItem(edge_id_to_route_item);
     }
 }
\ No newline at end of file
@@ -38,6 +38,13 @@ private:
 
     void DeserializeTransportCatalogue();
     void DeserializeRenderer();
-    void DeserializeTransportRouter();  
+    // Arrays stored after the message
+    struct RawSections {
+        std::optional<graph::Router<double>::RoutesStorage> routes_internal_data;
+        std::optional<graph::HubLabels<double>::LabelSet> outgoing_labels;
+        std::optional<graph::HubLabels<double>::LabelSet> incoming_labels;
+    };
+
+    void DeserializeTransportRouter(RawSections raw_sections);
 };
 }
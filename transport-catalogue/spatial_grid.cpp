@@ -0,0 +1,328 @@
+#define _USE_MATH_DEFINES
+#include "spatial_grid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+namespace transport_catalogue {
+    using namespace std::string_literals;
+
+    namespace {
+        constexpr double DEG_TO_RAD = M_PI / 180.0;
+        constexpr double METERS_IN_DEGREE = 6371000.0 * DEG_TO_RAD;
+        constexpr double MIN_CELL_SIZE = 50.0;
+        constexpr double STOPS_PER_CELL = 2.0;
+        constexpr double MIN_COS_LAT = 1e-3;
+        // The equirectangular distance exceeds the great-circle one only by a second-order term,
+        // which this factor covers for spans up to thousands of kilometers
+        constexpr double BOUND_SLACK = 0.99;
+
+        // Takes the longitude difference at the smallest cosine of latitude between the points
+        double ComputeDistanceLowerBound(geo::Coordinates from, geo::Coordinates to, double min_cos_lat) {
+            const double lng_difference = std::abs(to.lng - from.lng);
+            const double dx = std::min(lng_difference, 360.0 - lng_difference) * min_cos_lat;
+            const double dy = to.lat - from.lat;
+            return std::sqrt(dx * dx + dy * dy) * METERS_IN_DEGREE * BOUND_SLACK;
+        }
+
+        // Rounding may push the argument of acos slightly over one for points a few centimeters apart
+        double ComputeExactDistance(geo::Coordinates from, geo::Coordinates to) {
+            const double distance = geo::ComputeDistance(from, to);
+            return std::isnan(distance) ? 0.0 : distance;
+        }
+
+        bool IsCloser(const SpatialGrid::NearbyStop& lhs, const SpatialGrid::NearbyStop& rhs) {
+            return std::tie(lhs.distance, lhs.stop_id) < std::tie(rhs.distance, rhs.stop_id);
+        }
+    }
+
+    // The cell size is chosen for a couple of stops per cell on average, and doubled while
+    // the stops are so unevenly spread that the grid would have too many empty cells
+    SpatialGrid::SpatialGrid(const std::vector<geo::Coordinates>& stop_coords) {
+        if (stop_coords.size() >= std::numeric_limits<uint32_t>::max()) {
+            throw std::overflow_error("Too many stops for the spatial grid"s);
+        }
+        if (stop_coords.empty()) {
+            geometry_.rows = 1;
+            geometry_.cols = 1;
+            cell_offsets_.assign(2, 0);
+            return;
+        }
+
+        double max_lat = stop_coords.front().lat;
+        double max_lng = stop_coords.front().lng;
+        geometry_.min_lat = max_lat;
+        geometry_.min_lng = max_lng;
+        for (const geo::Coordinates& coords : stop_coords) {
+            geometry_.min_lat = std::min(geometry_.min_lat, coords.lat);
+            geometry_.min_lng = std::min(geometry_.min_lng, coords.lng);
+            max_lat = std::max(max_lat, coords.lat);
+            max_lng = std::max(max_lng, coords.lng);
+        }
+        points_ = stop_coords;
+        SetUpMinCosLat();
+
+        const double lng_scale = std::max(min_cos_lat_, MIN_COS_LAT);
+        const double height = (max_lat - geometry_.min_lat) * METERS_IN_DEGREE;
+        const double width = (max_lng - geometry_.min_lng) * METERS_IN_DEGREE * lng_scale;
+        const double max_cell_count = 4.0 * stop_coords.size() + 16.0;
+
+        double cell_size = std::max(MIN_CELL_SIZE, std::sqrt(height * width * STOPS_PER_CELL / stop_coords.size()));
+        double rows = std::floor(height / cell_size) + 1.0;
+        double cols = std::floor(width / cell_size) + 1.0;
+        while (rows * cols > max_cell_count) {
+            cell_size *= 2.0;
+            rows = std::floor(height / cell_size) + 1.0;
+            cols = std::floor(width / cell_size) + 1.0;
+        }
+        geometry_.rows = static_cast<uint32_t>(rows);
+        geometry_.cols = static_cast<uint32_t>(cols);
+        geometry_.lat_step = cell_size / METERS_IN_DEGREE;
+        geometry_.lng_step = cell_size / (METERS_IN_DEGREE * lng_scale);
+
+        std::vector<uint32_t> stop_cells(stop_coords.size());
+        cell_offsets_.assign(static_cast<size_t>(geometry_.rows) * geometry_.cols + 1, 0);
+        for (StopId stop_id = 0; stop_id < stop_coords.size(); ++stop_id) {
+            stop_cells[stop_id] = GetRow(stop_coords[stop_id].lat) * geometry_.cols + GetCol(stop_coords[stop_id].lng);
+            ++cell_offsets_[stop_cells[stop_id] + 1];
+        }
+        for (size_t cell = 1; cell < cell_offsets_.size(); ++cell) {
+            cell_offsets_[cell] += cell_offsets_[cell - 1];
+        }
+
+        std::vector<uint32_t> positions(cell_offsets_.begin(), cell_offsets_.end() - 1);
+        stop_ids_.resize(stop_coords.size());
+        for (StopId stop_id = 0; stop_id < stop_coords.size(); ++stop_id) {
+            const uint32_t position = positions[stop_cells[stop_id]]++;
+            stop_ids_[position] = stop_id;
+            points_[position] = stop_coords[stop_id];
+        }
+    }
+
+    SpatialGrid::SpatialGrid(const std::vector<geo::Coordinates>& stop_coords, Geometry geometry,
+                             std::vector<uint32_t> cell_offsets, std::vector<StopId> stop_ids)
+        : geometry_(geometry), cell_offsets_(std::move(cell_offsets)), stop_ids_(std::move(stop_ids)) {
+        if (geometry_.rows == 0 || geometry_.cols == 0 || !(geometry_.lat_step > 0.0) || !(geometry_.lng_step > 0.0)
+            || cell_offsets_.size() != static_cast<size_t>(geometry_.rows) * geometry_.cols + 1
+            || cell_offsets_.front() != 0 || !std::is_sorted(cell_offsets_.begin(), cell_offsets_.end())
+            || cell_offsets_.back() != stop_ids_.size() || stop_ids_.size() != stop_coords.size()) {
+            throw std::invalid_argument("Spatial grid doesn't match the stops"s);
+        }
+
+        points_.reserve(stop_ids_.size());
+        for (const StopId stop_id : stop_ids_) {
+            if (stop_id >= stop_coords.size()) {
+                throw std::invalid_argument("Spatial grid doesn't match the stops"s);
+            }
+            points_.push_back(stop_coords[stop_id]);
+        }
+        SetUpMinCosLat();
+    }
+
+    void SpatialGrid::SetUpMinCosLat() {
+        min_cos_lat_ = 1.0;
+        for (const geo::Coordinates& point : points_) {
+            min_cos_lat_ = std::min(min_cos_lat_, std::cos(point.lat * DEG_TO_RAD));
+        }
+    }
+
+    const SpatialGrid::Geometry& SpatialGrid::GetGeometry() const {
+        return geometry_;
+    }
+
+    const std::vector<uint32_t>& SpatialGrid::GetCellOffsets() const {
+        return cell_offsets_;
+    }
+
+    const std::vector<StopId>& SpatialGrid::GetStopIds() const {
+        return stop_ids_;
+    }
+
+    // Coordinates outside the grid fall into its border cells
+    uint32_t SpatialGrid::GetRow(double lat) const {
+        const double row = std::floor((lat - geometry_.min_lat) / geometry_.lat_step);
+        if (!(row > 0.0)) {
+            return 0;
+        }
+        return (row < geometry_.rows - 1) ? static_cast<uint32_t>(row) : geometry_.rows - 1;
+    }
+
+    uint32_t SpatialGrid::GetCol(double lng) const {
+        const double col = std::floor((lng - geometry_.min_lng) / geometry_.lng_step);
+        if (!(col > 0.0)) {
+            return 0;
+        }
+        return (col < geometry_.cols - 1) ? static_cast<uint32_t>(col) : geometry_.cols - 1;
+    }
+
+    std::vector<SpatialGrid::NearbyStop> SpatialGrid::FindStopsInRadius(geo::Coordinates point, double radius) const {
+        std::vector<NearbyStop> stops;
+        if (!(radius >= 0.0) || stop_ids_.empty()) {
+            return stops;
+        }
+
+        const double lat_radius = radius / METERS_IN_DEGREE / BOUND_SLACK;
+        const double max_abs_lat = std::min(90.0, std::max(std::abs(point.lat - lat_radius), std::abs(point.lat + lat_radius)));
+        const double min_cos_lat = std::min(min_cos_lat_, std::cos(max_abs_lat * DEG_TO_RAD));
+        const double lng_radius = (min_cos_lat > MIN_COS_LAT) ? lat_radius / min_cos_lat : 180.0;
+
+        const uint32_t row_end = GetRow(point.lat + lat_radius);
+        const uint32_t col_begin = GetCol(point.lng - lng_radius);
+        const uint32_t col_end = GetCol(point.lng + lng_radius);
+        for (uint32_t row = GetRow(point.lat - lat_radius); row <= row_end; ++row) {
+            const size_t row_offset = static_cast<size_t>(row) * geometry_.cols;
+            for (uint32_t i = cell_offsets_[row_offset + col_begin]; i < cell_offsets_[row_offset + col_end + 1]; ++i) {
+                if (ComputeDistanceLowerBound(point, points_[i], min_cos_lat) > radius) {
+                    continue;
+                }
+                const double distance = ComputeExactDistance(point, points_[i]);
+                if (distance <= radius) {
+                    stops.push_back({ stop_ids_[i], distance });
+                }
+            }
+        }
+
+        std::sort(stops.begin(), stops.end(), IsCloser);
+        return stops;
+    }
+
+    // Self-join over the cells: the stops of a cell are paired with the later stops of the same cell and of the cells
+    // after it in the same row, then with the stops of the cells below within the window. The window is the same
+    // for all the cells, as the lower bound of the longitude distances is taken over all the stops anyway.
+    std::vector<SpatialGrid::StopPair> SpatialGrid::FindStopPairsInRadius(double radius) const {
+        std::vector<StopPair> pairs;
+        if (!(radius >= 0.0) || stop_ids_.empty()) {
+            return pairs;
+        }
+
+        const double lat_radius = radius / METERS_IN_DEGREE / BOUND_SLACK;
+        const double lng_radius = (min_cos_lat_ > MIN_COS_LAT) ? lat_radius / min_cos_lat_ : 180.0;
+        const uint32_t row_span = static_cast<uint32_t>(std::min<double>(geometry_.rows, std::ceil(lat_radius / geometry_.lat_step)));
+        const uint32_t col_span = static_cast<uint32_t>(std::min<double>(geometry_.cols, std::ceil(lng_radius / geometry_.lng_step)));
+
+        const auto pair_with_range = [&](uint32_t i, uint32_t begin, uint32_t end) {
+            for (uint32_t j = begin; j < end; ++j) {
+                if (ComputeDistanceLowerBound(points_[i], points_[j], min_cos_lat_) > radius) {
+                    continue;
+                }
+                const double distance = ComputeExactDistance(points_[i], points_[j]);
+                if (distance <= radius) {
+                    pairs.push_back({ std::min(stop_ids_[i], stop_ids_[j]), std::max(stop_ids_[i], stop_ids_[j]), distance });
+                }
+            }
+        };
+        for (uint32_t row = 0; row < geometry_.rows; ++row) {
+            const uint32_t row_end = std::min(geometry_.rows - 1, row + row_span);
+            for (uint32_t col = 0; col < geometry_.cols; ++col) {
+                const size_t cell = static_cast<size_t>(row) * geometry_.cols + col;
+                if (cell_offsets_[cell] == cell_offsets_[cell + 1]) {
+                    continue;
+                }
+                const uint32_t col_begin = (col > col_span) ? col - col_span : 0;
+                const uint32_t col_end = std::min(geometry_.cols - 1, col + col_span);
+                for (uint32_t i = cell_offsets_[cell]; i < cell_offsets_[cell + 1]; ++i) {
+                    pair_with_range(i, i + 1, cell_offsets_[static_cast<size_t>(row) * geometry_.cols + col_end + 1]);
+                    for (uint32_t other_row = row + 1; other_row <= row_end; ++other_row) {
+                        const size_t row_offset = static_cast<size_t>(other_row) * geometry_.cols;
+                        pair_with_range(i, cell_offsets_[row_offset + col_begin], cell_offsets_[row_offset + col_end + 1]);
+                    }
+                }
+            }
+        }
+
+        std::sort(pairs.begin(), pairs.end(), [](const StopPair& lhs, const StopPair& rhs) {
+            return std::tie(lhs.from, lhs.to) < std::tie(rhs.from, rhs.to);
+        });
+        return pairs;
+    }
+
+    // Rings of cells around the cell of the point are scanned until the block of scanned cells is known
+    // to hold all the nearest stops: the farthest of them is closer than any side of the block
+    std::vector<SpatialGrid::NearbyStop> SpatialGrid::FindNearestStops(geo::Coordinates point, size_t count) const {
+        std::vector<NearbyStop> nearest;  // max-heap while searching
+        count = std::min(count, stop_ids_.size());
+        if (count == 0) {
+            return nearest;
+        }
+        nearest.reserve(count);
+
+        const double min_cos_lat = std::min(min_cos_lat_, std::cos(point.lat * DEG_TO_RAD));
+        const auto visit_cell = [&](int64_t row, int64_t col) {
+            const size_t cell = static_cast<size_t>(row) * geometry_.cols + col;
+            for (uint32_t i = cell_offsets_[cell]; i < cell_offsets_[cell + 1]; ++i) {
+                const bool is_full = nearest.size() == count;
+                if (is_full && ComputeDistanceLowerBound(point, points_[i], min_cos_lat) > nearest.front().distance) {
+                    continue;
+                }
+                const NearbyStop candidate{ stop_ids_[i], ComputeExactDistance(point, points_[i]) };
+                if (!is_full) {
+                    nearest.push_back(candidate);
+                    std::push_heap(nearest.begin(), nearest.end(), IsCloser);
+                } else if (IsCloser(candidate, nearest.front())) {
+                    std::pop_heap(nearest.begin(), nearest.end(), IsCloser);
+                    nearest.back() = candidate;
+                    std::push_heap(nearest.begin(), nearest.end(), IsCloser);
+                }
+            }
+        };
+
+        const int64_t rows = geometry_.rows;
+        const int64_t cols = geometry_.cols;
+        const int64_t center_row = GetRow(point.lat);
+        const int64_t center_col = GetCol(point.lng);
+        for (int64_t ring = 0; ; ++ring) {
+            const int64_t row_begin = center_row - ring;
+            const int64_t row_end = center_row + ring;
+            const int64_t col_begin = center_col - ring;
+            const int64_t col_end = center_col + ring;
+
+            for (int64_t row = std::max<int64_t>(row_begin, 0); row <= std::min(row_end, rows - 1); ++row) {
+                if (row == row_begin || row == row_end) {
+                    for (int64_t col = std::max<int64_t>(col_begin, 0); col <= std::min(col_end, cols - 1); ++col) {
+                        visit_cell(row, col);
+                    }
+                } else {
+                    if (col_begin >= 0) {
+                        visit_cell(row, col_begin);
+                    }
+                    if (col_end < cols) {
+                        visit_cell(row, col_end);
+                    }
+                }
+            }
+
+            if (row_begin <= 0 && col_begin <= 0 && row_end >= rows - 1 && col_end >= cols - 1) {
+                break;
+            }
+            if (nearest.size() == count) {
+                double bound = std::numeric_limits<double>::infinity();
+                if (row_end < rows - 1) {
+                    const double lat = geometry_.min_lat + (row_end + 1) * geometry_.lat_step;
+                    bound = std::min(bound, (lat - point.lat) * METERS_IN_DEGREE * BOUND_SLACK);
+                }
+                if (row_begin > 0) {
+                    const double lat = geometry_.min_lat + row_begin * geometry_.lat_step;
+                    bound = std::min(bound, (point.lat - lat) * METERS_IN_DEGREE * BOUND_SLACK);
+                }
+                if (col_end < cols - 1) {
+                    const double lng = geometry_.min_lng + (col_end + 1) * geometry_.lng_step;
+                    bound = std::min(bound, (lng - point.lng) * METERS_IN_DEGREE * min_cos_lat * BOUND_SLACK);
+                }
+                if (col_begin > 0) {
+                    const double lng = geometry_.min_lng + col_begin * geometry_.lng_step;
+                    bound = std::min(bound, (point.lng - lng) * METERS_IN_DEGREE * min_cos_lat * BOUND_SLACK);
+                }
+                if (nearest.front().distance <= bound) {
+                    break;
+                }
+            }
+        }
+
+        std::sort_heap(nearest.begin(), nearest.end(), IsCloser);
+        return nearest;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "domain.h"
+#include "geo.h"
+
+namespace transport_catalogue {
+// Uniform latitude/longitude grid over the stops. Cells are roughly square in meters and hold a couple
+// of stops on average; the stops of every cell are kept in CSR form, cells in row-major order.
+// Candidates are first checked with a cheap equirectangular lower bound of the distance, and only
+// the ones passing it get the exact geo::ComputeDistance.
+class SpatialGrid {
+public:
+    struct Geometry {
+        double min_lat = 0.0;
+        double min_lng = 0.0;
+        double lat_step = 1.0;
+        double lng_step = 1.0;
+        uint32_t rows = 0;
+        uint32_t cols = 0;
+    };
+
+    struct NearbyStop {
+        StopId stop_id;
+        double distance;
+    };
+
+    struct StopPair {
+        StopId from;  // the lesser id
+        StopId to;
+        double distance;
+    };
+
+    SpatialGrid() = default;
+    explicit SpatialGrid(const std::vector<geo::Coordinates>& stop_coords);
+    // Restores a grid built earlier for the same stops
+    SpatialGrid(const std::vector<geo::Coordinates>& stop_coords, Geometry geometry,
+                std::vector<uint32_t> cell_offsets, std::vector<StopId> stop_ids);
+
+    const Geometry& GetGeometry() const;
+    const std::vector<uint32_t>& GetCellOffsets() const;
+    const std::vector<StopId>& GetStopIds() const;
+
+    // Both sorted by distance, ties by id
+    std::vector<NearbyStop> FindStopsInRadius(geo::Coordinates point, double radius) const;
+    std::vector<NearbyStop> FindNearestStops(geo::Coordinates point, size_t count) const;
+    // Every pair of stops within the radius of each other once, sorted by ids
+    std::vector<StopPair> FindStopPairsInRadius(double radius) const;
+
+private:
+    Geometry geometry_;
+    std::vector<uint32_t> cell_offsets_;
+    std::vector<StopId> stop_ids_;
+    std::vector<geo::Coordinates> points_;  // alongside stop_ids_
+    double min_cos_lat_ = 1.0;  // over all the stops, for the lower bounds of the longitude distances
+
+    uint32_t GetRow(double lat) const;
+    uint32_t GetCol(double lng) const;
+    void SetUpMinCosLat();
+};
+}
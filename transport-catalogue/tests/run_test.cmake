@@ -0,0 +1,47 @@
+# Runs make_base and then process_requests of a fixture and compares the output with the expected one.
+# Every test works in a directory of its own, so the bases of tests run in parallel don't clash.
+# ENGINE and GRAPH_MODEL, when set, replace router_engine and graph_model of the make_base routing_settings,
+# so one network is checked under several engines without a copy of it per engine.
+foreach(variable BINARY MAKE_BASE PROCESS_REQUESTS EXPECTED WORK_DIR)
+    if(NOT DEFINED ${variable})
+        message(FATAL_ERROR "${variable} is not set")
+    endif()
+endforeach()
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+if(DEFINED ENGINE OR DEFINED GRAPH_MODEL)
+    file(READ ${MAKE_BASE} make_base)
+    if(DEFINED ENGINE)
+        string(JSON make_base SET "${make_base}" routing_settings router_engine "\"${ENGINE}\"")
+    endif()
+    if(DEFINED GRAPH_MODEL)
+        string(JSON make_base SET "${make_base}" routing_settings graph_model "\"${GRAPH_MODEL}\"")
+    endif()
+    set(MAKE_BASE ${WORK_DIR}/make_base.json)
+    file(WRITE ${MAKE_BASE} "${make_base}")
+endif()
+
+execute_process(COMMAND ${BINARY} make_base
+    INPUT_FILE ${MAKE_BASE}
+    WORKING_DIRECTORY ${WORK_DIR}
+    RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "make_base failed: ${result}")
+endif()
+
+execute_process(COMMAND ${BINARY} process_requests
+    INPUT_FILE ${PROCESS_REQUESTS}
+    OUTPUT_FILE ${WORK_DIR}/output.json
+    WORKING_DIRECTORY ${WORK_DIR}
+    RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "process_requests failed: ${result}")
+endif()
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${WORK_DIR}/output.json ${EXPECTED}
+    RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${WORK_DIR}/output.json differs from ${EXPECTED}")
+endif()
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+inline size_t GetDefaultThreadCount() {
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+// Fixed set of worker threads for data-parallel loops. The calling thread takes part in
+// every ParallelFor, so a pool of N threads starts N - 1 workers.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t thread_count = GetDefaultThreadCount());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t GetThreadCount() const;
+
+    // Calls func(i) for every i in [0, count) and returns when all calls have finished.
+    // The first exception thrown by func is rethrown in the calling thread.
+    template <typename Func>
+    void ParallelFor(size_t count, Func&& func);
+
+private:
+    void WorkerLoop();
+    void RunTasks();
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable task_cv_;
+    std::condition_variable done_cv_;
+
+    std::function<void(size_t)> task_;
+    size_t task_count_ = 0;
+    std::atomic<size_t> next_index_{0};
+    uint64_t generation_ = 0;
+    size_t finished_workers_ = 0;
+    bool stopping_ = false;
+    std::exception_ptr error_;
+};
+
+inline ThreadPool::ThreadPool(size_t thread_count) {
+    const size_t worker_count = std::max<size_t>(1, thread_count) - 1;
+    workers_.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        workers_.emplace_back([this] { WorkerLoop(); });
+    }
+}
+
+inline ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    task_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+inline size_t ThreadPool::GetThreadCount() const {
+    return workers_.size() + 1;
+}
+
+template <typename Func>
+void ThreadPool::ParallelFor(size_t count, Func&& func) {
+    if (count == 0) {
+        return;
+    }
+    if (workers_.empty() || count == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            func(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        task_ = std::ref(func);
+        task_count_ = count;
+        next_index_ = 0;
+        finished_workers_ = 0;
+        error_ = nullptr;
+        ++generation_;
+    }
+    task_cv_.notify_all();
+
+    RunTasks();
+
+    std::unique_lock lock(mutex_);
+    done_cv_.wait(lock, [this] { return finished_workers_ == workers_.size(); });
+    task_ = nullptr;
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+inline void ThreadPool::WorkerLoop() {
+    uint64_t seen_generation = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            task_cv_.wait(lock, [&] { return stopping_ || generation_ != seen_generation; });
+            if (stopping_) {
+                return;
+            }
+            seen_generation = generation_;
+        }
+
+        RunTasks();
+
+        {
+            std::lock_guard lock(mutex_);
+            ++finished_workers_;
+        }
+        done_cv_.notify_one();
+    }
+}
+
+inline void ThreadPool::RunTasks() {
+    for (size_t i = next_index_++; i < task_count_; i = next_index_++) {
+        try {
+            task_(i);
+        } catch (...) {
+            std::lock_guard lock(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+        }
+    }
+}
+
+}  // namespace parallel
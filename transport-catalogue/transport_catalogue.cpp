@@ -1,6 +1,7 @@
 #include "transport_catalogue.h"
 
 #include <string>
+#include <optional>
 #include <set>
 #include <string_view>
 #include <iostream>
@@ -12,176 +13,132 @@ namespace transport_catalogue {
 
     TransportCatalogue::TransportCatalogue() { }
 
-    void TransportCatalogue::AddDummyStop(std::string_view stopname) {
+    StopId TransportCatalogue::AddDummyStop(std::string_view stopname) {
+        spatial_grid_.reset();
         Stop stop{};
         stop.name = stopname;
+        const StopId stop_id = static_cast<StopId>(stops_.size());
         stops_.emplace_back(stop);
-        stopname_to_stop_[stops_.back().name] = &stops_.back();
+        stopname_to_stop_id_[stops_.back().name] = stop_id;
+        return stop_id;
     }
 
     void TransportCatalogue::AddStop(const Stop& stop) {
-        if (stopname_to_stop_.count(stop.name)) {
-            stopname_to_stop_.at(stop.name)->coords = { stop.coords.lat, stop.coords.lng };
-            stopname_to_stop_.at(stop.name)->range_to_other_stop.insert(
+        snapshot_.reset();
+        spatial_grid_.reset();
+
+        StopId from_id;
+        if (stopname_to_stop_id_.count(stop.name)) {
+            from_id = stopname_to_stop_id_.at(stop.name);
+            stops_[from_id].coords = { stop.coords.lat, stop.coords.lng };
+            stops_[from_id].range_to_other_stop.insert(
                 stop.range_to_other_stop.begin(), stop.range_to_other_stop.end()
             );
         }
         else {
+            from_id = static_cast<StopId>(stops_.size());
             stops_.emplace_back(stop);
-            stopname_to_stop_[stops_.back().name] = &stops_.back();
+            stopname_to_stop_id_[stops_.back().name] = from_id;
         }
 
         for (const auto & [stopname, range] : stop.range_to_other_stop) {
-            auto from_ref = stopname_to_stop_.at(stop.name);
-            if (stopname_to_stop_.count(stopname) == 0) {
-                AddDummyStop(stopname);
-            }
-            auto to_ref = stopname_to_stop_.at(stopname);
+            const auto it = stopname_to_stop_id_.find(stopname);
+            const StopId to_id = (it != stopname_to_stop_id_.end()) ? it->second : AddDummyStop(stopname);
 
-            stop_pair_to_distance_[{from_ref,to_ref}] = static_cast<double>(range);
-
-            if (stop_pair_to_distance_.count({to_ref, from_ref}) == 0) {
-                stop_pair_to_distance_[{to_ref, from_ref}] = stop_pair_to_distance_.at({from_ref, to_ref});
-            }
+            road_distances_.Set(from_id, to_id, static_cast<double>(range));
+            road_distances_.SetIfAbsent(to_id, from_id, static_cast<double>(range));
         }
     }
 
     const Stop TransportCatalogue::FindStop(std::string_view stopname) const {
-        if (stopname_to_stop_.count(stopname)) {
-            return *stopname_to_stop_.at(stopname);
-        }
-        else {
-            throw std::out_of_range("not found"s);
-        }
+        return *FindStopRef(stopname);
     }
 
     const Stop* TransportCatalogue::FindStopRef(std::string_view stopname) const {
-        if (stopname_to_stop_.count(stopname)) {
-            return stopname_to_stop_.at(stopname);
-        }
-        else {
-            throw std::out_of_range("not found"s);
-        }
+        return &stops_[GetStopId(stopname)];
     }
 
-    StopInfo TransportCatalogue::GetStopInfo(std::string_view stopname) {
-        if (stopname_to_stop_.count(stopname) < 1) {
-            throw std::out_of_range("not found"s);
-        }
-
-        StopInfo stopinfo;
-        stopinfo.name = stopname;
-
-        if (stop_to_buses_.count(stopname_to_stop_.at(stopinfo.name)) == 0) {
-            return stopinfo;
-        }
-
-        stopinfo.buses.reserve(stop_to_buses_.at(stopname_to_stop_.at(stopinfo.name)).size());
-
-        for (const auto& bus_ref : stop_to_buses_.at(stopname_to_stop_.at(stopinfo.name))) {
-            stopinfo.buses.emplace_back(bus_ref->num);
-        }
-
-        std::sort(stopinfo.buses.begin(), stopinfo.buses.end());
-
-        return stopinfo;
+    size_t TransportCatalogue::GetStopCount() const {
+        return stops_.size();
     }
-    
-    void TransportCatalogue::AddBus(const Bus& bus) {
-        buses_.emplace_back(bus);
-        busname_to_bus_[buses_.back().num] = &buses_.back();
 
-        for (std::string_view stopname : bus.stopnames) {
-            if (stopname_to_stop_.count(stopname) == 0) {
-                AddDummyStop(stopname);
-            }
-
-            stop_to_buses_[stopname_to_stop_.at(stopname)].insert(&buses_.back());
-        }
+    size_t TransportCatalogue::GetBusCount() const {
+        return buses_.size();
     }
 
-    const Bus TransportCatalogue::FindBus(std::string_view busnum) const {
-        if (busname_to_bus_.count(busnum)) {
-            return *busname_to_bus_.at(busnum);
-        }
-        else {
+    StopId TransportCatalogue::GetStopId(std::string_view stopname) const {
+        const auto it = stopname_to_stop_id_.find(stopname);
+        if (it == stopname_to_stop_id_.end()) {
             throw std::out_of_range("not found"s);
-        } 
+        }
+        return it->second;
     }
 
-    const Bus* TransportCatalogue::FindBusRef(std::string_view busnum) const {
-        if (busname_to_bus_.count(busnum)) {
-            return busname_to_bus_.at(busnum);
-        }
-        else {
+    BusId TransportCatalogue::GetBusId(std::string_view busnum) const {
+        const auto it = busname_to_bus_id_.find(busnum);
+        if (it == busname_to_bus_id_.end()) {
             throw std::out_of_range("not found"s);
-        } 
+        }
+        return it->second;
     }
 
-    double TransportCatalogue::GetDistance(std::string_view from_stop_name, std::string_view to_stop_name) const {
-        auto from_ref = stopname_to_stop_.at(from_stop_name);
-        auto to_ref = stopname_to_stop_.at(to_stop_name);
+    const Stop& TransportCatalogue::GetStop(StopId stop_id) const {
+        return stops_.at(stop_id);
+    }
 
-        return stop_pair_to_distance_.at({from_ref, to_ref}); 
+    const BusRoute& TransportCatalogue::GetBus(BusId bus_id) const {
+        return buses_.at(bus_id);
     }
 
-    BusInfo TransportCatalogue::GetBusInfo(std::string_view busnum) {
-        const Bus* bus_ref = TransportCatalogue::FindBusRef(busnum);
+    void TransportCatalogue::AddBus(const Bus& bus) {
+        snapshot_.reset();
 
-        BusInfo businfo;
-        businfo.num = busnum;
-        businfo.stops_count = bus_ref->is_circular_route ? bus_ref->stopnames.size() : 2 * bus_ref->stopnames.size() - 1;
+        const BusId bus_id = static_cast<BusId>(buses_.size());
 
-        std::set<Stop*> unique_stops;
-        for (const auto& stop_name : bus_ref->stopnames) {           
-            unique_stops.insert(stopname_to_stop_.at(stop_name));
+        BusRoute bus_route;
+        bus_route.is_circular_route = bus.is_circular_route;
+        bus_route.num = bus.num;
+        bus_route.stop_ids.reserve(bus.stopnames.size());
+        for (std::string_view stopname : bus.stopnames) {
+            const auto it = stopname_to_stop_id_.find(stopname);
+            const StopId stop_id = (it != stopname_to_stop_id_.end()) ? it->second : AddDummyStop(stopname);
+            bus_route.stop_ids.push_back(stop_id);
         }
-        businfo.unique_stops_count = unique_stops.size();
 
-        double direct_route_length = 0.0;
+        buses_.emplace_back(std::move(bus_route));
+        busname_to_bus_id_[buses_.back().num] = bus_id;
+    }
 
-        for (size_t from=0, to=1; to<bus_ref->stopnames.size(); ++from, ++to) {
-            double d_route = GetDistance(bus_ref->stopnames[from], bus_ref->stopnames[to]);
-            businfo.route_length += d_route;
+    double TransportCatalogue::GetDistance(std::string_view from_stop_name, std::string_view to_stop_name) const {
+        return GetDistance(GetStopId(from_stop_name), GetStopId(to_stop_name));
+    }
 
-            direct_route_length += ComputeDistance(
-                stopname_to_stop_.at(bus_ref->stopnames[from])->coords, 
-                stopname_to_stop_.at(bus_ref->stopnames[to])->coords
-            );
+    double TransportCatalogue::GetDistance(StopId from, StopId to) const {
+        const std::optional<double> distance = road_distances_.Find(from, to);
+        if (!distance) {
+            throw std::out_of_range("not found"s);
         }
+        return *distance;
+    }
 
-        if (!bus_ref->is_circular_route) {
-            for (int from=bus_ref->stopnames.size()-1, to=bus_ref->stopnames.size()-2; to>=0; from--, to--) {
-                double d_route = GetDistance(bus_ref->stopnames[from], bus_ref->stopnames[to]);
-                businfo.route_length += d_route;
-
-                direct_route_length += ComputeDistance(
-                    stopname_to_stop_.at(bus_ref->stopnames[from])->coords,
-                    stopname_to_stop_.at(bus_ref->stopnames[to])->coords
-                );
-            }
+    void TransportCatalogue::Freeze() {
+        if (snapshot_) {
+            return;
         }
-
-        businfo.route_curvature = businfo.route_length / direct_route_length;
-
-        return businfo;
+        road_distances_.Freeze();
+        snapshot_ = std::make_shared<const CatalogueSnapshot>(*this, road_distances_, spatial_grid_);
     }
 
-    BusExtendedInfo TransportCatalogue::GetBusExtendedInfo(std::string_view busnum) {
-        const Bus* bus_ref = TransportCatalogue::FindBusRef(busnum);
-
-        BusExtendedInfo businfo;
-
-        businfo.name = bus_ref->num;
-        businfo.is_circular_route = bus_ref->is_circular_route;
-        businfo.stops_and_coordinates.reserve(bus_ref->stopnames.size());
+    void TransportCatalogue::SetSpatialGrid(SpatialGrid spatial_grid) {
+        snapshot_.reset();
+        spatial_grid_ = std::move(spatial_grid);
+    }
 
-        for (const auto&  stop_name : bus_ref->stopnames) {
-            const Stop* stop_ref = TransportCatalogue::FindStopRef(stop_name);
-            businfo.stops_and_coordinates.push_back({stop_name, stop_ref->coords});
+    const CatalogueSnapshot& TransportCatalogue::GetSnapshot() const {
+        if (!snapshot_) {
+            throw std::logic_error("The catalogue should be frozen after it changes"s);
         }
-
-        return businfo;
+        return *snapshot_;
     }
 
     const std::vector<std::string_view> TransportCatalogue::GetBusList() const {
@@ -206,4 +163,3 @@ namespace transport_catalogue {
         return stop_names;
     }
 }
-  
\ No newline at end of file
@@ -1,13 +1,16 @@
 #pragma once
 
 #include <deque>
+#include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
 #include <cstdint>
 
 #include "domain.h"
+#include "road_distances.h"
+#include "catalogue_snapshot.h"
 
 namespace transport_catalogue {
     class TransportCatalogue {
@@ -15,43 +18,42 @@ namespace transport_catalogue {
         explicit TransportCatalogue();
 
         void AddStop(const Stop& stop);
-        StopInfo GetStopInfo(std::string_view stopname);
-
         void AddBus(const Bus& bus);
-        BusInfo GetBusInfo(std::string_view busnum);
-
-        BusExtendedInfo GetBusExtendedInfo(std::string_view busnum);
 
         const std::vector<std::string_view> GetBusList() const;
         const std::vector<std::string_view> GetStopList() const;
 
         double GetDistance(std::string_view from_stop_name, std::string_view to_stop_name) const;
+        double GetDistance(StopId from, StopId to) const;
+
+        // Compacts the catalogue into a read-only snapshot that serves the stat queries.
+        // Any change to the catalogue drops the snapshot, so it has to be frozen again.
+        void Freeze();
+        const CatalogueSnapshot& GetSnapshot() const;
+        // A grid restored from the base is used by the next freeze, unless the stops change before it
+        void SetSpatialGrid(SpatialGrid spatial_grid);
+
+        // Names are resolved to ids once, at the request boundary; everything inside works with ids
+        size_t GetStopCount() const;
+        size_t GetBusCount() const;
+        StopId GetStopId(std::string_view stopname) const;
+        BusId GetBusId(std::string_view busnum) const;
+        const Stop& GetStop(StopId stop_id) const;
+        const BusRoute& GetBus(BusId bus_id) const;
 
         const Stop FindStop(std::string_view stopname) const;
-        const Bus FindBus(std::string_view busnum) const;
         const Stop* FindStopRef(std::string_view stopname) const;
-        const Bus* FindBusRef(std::string_view busnum) const;
 
     private:
-        std::deque<Stop> stops_;
-        std::unordered_map<std::string_view, Stop*> stopname_to_stop_;
-        std::deque<Bus> buses_;
-        std::unordered_map<std::string_view, Bus*> busname_to_bus_;
-
-        struct StopPairHasher {
-            size_t operator() (std::pair<Stop*, Stop*> pair) const {          
-                size_t h_first = u_hasher_((uint64_t)pair.first);
-                size_t h_second = u_hasher_((uint64_t)pair.second);        
-                return h_first + h_second * 37;
-            }
-        private:
-            std::hash<uint64_t> u_hasher_;
-        };
-
-        std::unordered_map<std::pair<Stop*, Stop*>, double, StopPairHasher> stop_pair_to_distance_;
-        std::unordered_map<Stop*, std::unordered_set<Bus*>> stop_to_buses_;
-
-        void AddDummyStop(std::string_view stopname);
+        std::deque<Stop> stops_;  // indexed by StopId
+        std::unordered_map<std::string_view, StopId> stopname_to_stop_id_;
+        std::deque<BusRoute> buses_;  // indexed by BusId
+        std::unordered_map<std::string_view, BusId> busname_to_bus_id_;
+
+        RoadDistances road_distances_;
+        std::shared_ptr<const CatalogueSnapshot> snapshot_;
+        std::optional<SpatialGrid> spatial_grid_;
+
+        StopId AddDummyStop(std::string_view stopname);
     };
 }
-
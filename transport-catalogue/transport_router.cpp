@@ -6,12 +6,103 @@
 #include <iostream>
 #include <stdexcept>
 #include <algorithm>
+#include <type_traits>
+#include <limits>
+#include <cmath>
+#include <iterator>
+#include <unordered_map>
 
 namespace transport_catalogue {
     using namespace std::string_literals;
 
     void TransportRouter::UpdateRouter() {
-        router_.Update();
+        switch (routing_settings_.router_engine) {
+        case RouterEngine::Dijkstra:
+            graph_.Freeze();
+            router_.emplace<graph::DijkstraRouter<double>>(graph_);
+            break;
+        case RouterEngine::AStar:
+            graph_.Freeze();
+            router_.emplace<graph::DijkstraRouter<double>>(graph_, MakeGeoHeuristic());
+            break;
+        case RouterEngine::HubLabels:
+            graph_.EnableIncomingIndex();
+            graph_.Freeze();
+            router_.emplace<graph::HubLabels<double>>(graph_);
+            break;
+        case RouterEngine::Alt:
+            graph_.EnableIncomingIndex();
+            graph_.Freeze();
+            if (!landmarks_) {
+                landmarks_.emplace(graph_);
+            }
+            router_.emplace<graph::DijkstraRouter<double>>(graph_, [landmarks = &*landmarks_](graph::VertexId vertex, graph::VertexId target) {
+                return landmarks->GetLowerBound(vertex, target);
+            });
+            break;
+        case RouterEngine::BidirectionalDijkstra:
+            graph_.EnableIncomingIndex();
+            graph_.Freeze();
+            router_.emplace<graph::BidirectionalDijkstraRouter<double>>(graph_);
+            break;
+        case RouterEngine::ContractionHierarchy:
+            router_.emplace<graph::ContractionHierarchy<double>>(graph_);
+            break;
+        case RouterEngine::Raptor:
+            router_.emplace<RaptorRouter>(tc_, routing_settings_);
+            break;
+        default:
+            router_.emplace<graph::Router<double>>(graph_);
+            break;
+        }
+    }
+
+    const graph::Router<double>::RoutesStorage* TransportRouter::GetRoutesInternalData() const {
+        if (const auto* router = std::get_if<graph::Router<double>>(&router_)) {
+            return &router->GetRoutesInternalData();
+        }
+        return nullptr;
+    }
+
+    void TransportRouter::SetRoutesInternalData(graph::Router<double>::RoutesStorage routes_internal_data) {
+        router_.emplace<graph::Router<double>>(graph_, std::move(routes_internal_data));
+    }
+
+    const graph::ContractionHierarchy<double>* TransportRouter::GetContractionHierarchy() const {
+        return std::get_if<graph::ContractionHierarchy<double>>(&router_);
+    }
+
+    void TransportRouter::SetContractionHierarchy(std::vector<uint32_t> ranks, std::vector<graph::ContractionHierarchy<double>::Shortcut> shortcuts) {
+        router_.emplace<graph::ContractionHierarchy<double>>(graph_, std::move(ranks), std::move(shortcuts));
+    }
+
+    const graph::HubLabels<double>* TransportRouter::GetHubLabels() const {
+        return std::get_if<graph::HubLabels<double>>(&router_);
+    }
+
+    void TransportRouter::SetHubLabels(std::vector<graph::VertexId> vertices_by_rank, graph::HubLabels<double>::LabelSet outgoing_labels,
+                                       graph::HubLabels<double>::LabelSet incoming_labels) {
+        router_.emplace<graph::HubLabels<double>>(graph_, std::move(vertices_by_rank), std::move(outgoing_labels), std::move(incoming_labels));
+    }
+
+    const graph::Landmarks<double>* TransportRouter::GetLandmarks() const {
+        return landmarks_ ? &*landmarks_ : nullptr;
+    }
+
+    void TransportRouter::SetLandmarks(std::vector<graph::VertexId> landmarks, std::vector<double> weights_from_landmarks, std::vector<double> weights_to_landmarks) {
+        landmarks_.emplace(graph_, std::move(landmarks), std::move(weights_from_landmarks), std::move(weights_to_landmarks));
+        UpdateRouter();
+    }
+
+    std::optional<graph::RouteInfo<double>> TransportRouter::BuildRoute(graph::VertexId from, graph::VertexId to) const {
+        return std::visit([from, to](const auto& router) -> std::optional<graph::RouteInfo<double>> {
+            using RouterType = std::decay_t<decltype(router)>;
+            if constexpr (std::is_same_v<RouterType, std::monostate> || std::is_same_v<RouterType, RaptorRouter>) {
+                throw std::logic_error("router is not set up"s);
+            } else {
+                return router.BuildRoute(from, to);
+            }
+        }, router_);
     }
 
     const graph::DirectedWeightedGraph<double>& TransportRouter::GetGraph() const {
@@ -22,25 +113,33 @@ namespace transport_catalogue {
         return std::ref(graph_);
     }
 
-    const std::map<std::string_view, TransportRouter::StopItemPair>& TransportRouter::GetStopNameToVertexIdPair() const {
-        return std::ref(stopname_to_vertex_id_pair_);
+    const std::vector<std::optional<TransportRouter::StopItemPair>>& TransportRouter::GetStopVertices() const {
+        return stop_vertices_;
     }
 
-    const std::map<graph::VertexId, RouteItem>& TransportRouter::GetEdgeIdToRouteItem() const {
-        return std::ref(edge_id_to_route_item_);
+    const std::vector<TransportRouter::EdgeInfo>& TransportRouter::GetEdgeInfos() const {
+        return edge_infos_;
     }
 
-    void TransportRouter::SetStopnameToVertexIdPair(const std::map<std::string, StopItemPair>& stopname_to_vertex_id_pair) {
-        for (const auto& [key, value] : stopname_to_vertex_id_pair) {
-            const Stop* stop_ref = tc_.FindStopRef(key);
-            stopname_to_vertex_id_pair_.insert({ stop_ref->name, value });
+    void TransportRouter::SetStopVertices(std::vector<std::optional<StopItemPair>> stop_vertices) {
+        if (stop_vertices.size() > tc_.GetStopCount()) {
+            throw std::invalid_argument("stop vertices don't match the catalogue"s);
         }
+        stop_vertices_ = std::move(stop_vertices);
     }
 
-    void TransportRouter::SetEdgeIdToRouteItem(const std::map<graph::VertexId, RouteItem>& edge_id_to_route_item) {
-        for (const auto& item : edge_id_to_route_item) {
-            edge_id_to_route_item_.insert(item);
+    void TransportRouter::SetEdgeInfos(std::vector<EdgeInfo> edge_infos) {
+        if (edge_infos.size() != graph_.GetEdgeCount()) {
+            throw std::invalid_argument("edge infos don't match the graph"s);
         }
+        for (const EdgeInfo& edge_info : edge_infos) {
+            if (edge_info.kind > EdgeKind::Walk
+                || ((edge_info.kind == EdgeKind::Wait || edge_info.kind == EdgeKind::Walk) && edge_info.name_id >= tc_.GetStopCount())
+                || (edge_info.kind == EdgeKind::Ride && edge_info.name_id >= tc_.GetBusCount())) {
+                throw std::invalid_argument("edge infos don't match the catalogue"s);
+            }
+        }
+        edge_infos_ = std::move(edge_infos);
     }
 
     void TransportRouter::SetRoutingSettings(const RoutingSettings& routing_settings) {
@@ -52,100 +151,479 @@ namespace transport_catalogue {
     }
 
     void TransportRouter::SetUp(const RoutingSettings& routing_settings) {
+        SetRoutingSettings(routing_settings);
+
+        // RAPTOR works on the bus routes themselves and needs no graph
+        if (routing_settings_.router_engine == RouterEngine::Raptor) {
+            UpdateRouter();
+            return;
+        }
+
+        graph_.SetVertexCount(tc_.GetStopCount() * 2);
+
+        std::vector<BusId> bus_ids(tc_.GetBusCount());
+        for (BusId bus_id = 0; bus_id < bus_ids.size(); ++bus_id) {
+            bus_ids[bus_id] = bus_id;
+        }
+        AddBusesToGraph(bus_ids, 0);
+        AddWalkingTransferEdges();
+        UpdateRouter();
+    }
+
+    double TransportRouter::GetMetersToMinutesMultiplier() const {
         constexpr double SECONDS_IN_MINUTE = 60.0;
         constexpr double METERS_IN_KILOMETER = 1000.0;
+        return 1.0 / METERS_IN_KILOMETER / routing_settings_.bus_velocity * SECONDS_IN_MINUTE;
+    }
 
-        SetRoutingSettings(routing_settings);
+    double TransportRouter::GetWalkingMetersToMinutesMultiplier() const {
+        constexpr double SECONDS_IN_MINUTE = 60.0;
+        constexpr double METERS_IN_KILOMETER = 1000.0;
+        return 1.0 / METERS_IN_KILOMETER / routing_settings_.walking_velocity * SECONDS_IN_MINUTE;
+    }
+
+    // The great-circle distance between two stops scaled by the smallest ratio of road to great-circle
+    // distance over all route segments never exceeds the road distance of a ride between them, so over
+    // the bus velocity it bounds the rest of the route from below. Leaving a wait vertex for another stop
+    // also takes its wait edge, which is the only edge out of it. Both vertices of a stop take its location,
+    // the bus vertices of the bus_lines model take the location of the stop they are joined to by
+    // a weightless boarding or alighting edge. With walking transfers a wait vertex may also be left on foot,
+    // so the bound there is the lesser of a walk all the way and a wait with the rest at the faster of the two
+    // velocities, and the rest of the route from the other vertices is bounded at the faster velocity as well.
+    graph::DijkstraRouter<double>::Heuristic TransportRouter::MakeGeoHeuristic() const {
+        std::vector<std::optional<geo::Coordinates>> vertex_coordinates(graph_.GetVertexCount());
+        std::vector<bool> is_wait_vertex(graph_.GetVertexCount(), false);
+        for (StopId stop_id = 0; stop_id < stop_vertices_.size(); ++stop_id) {
+            if (!stop_vertices_[stop_id]) {
+                continue;
+            }
+            const geo::Coordinates& coords = tc_.GetStop(stop_id).coords;
+            vertex_coordinates[stop_vertices_[stop_id]->wait_on_stop_id] = coords;
+            vertex_coordinates[stop_vertices_[stop_id]->stop_id] = coords;
+            is_wait_vertex[stop_vertices_[stop_id]->wait_on_stop_id] = true;
+        }
+        for (graph::EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            if (edge.weight != 0.0) {
+                continue;
+            }
+            if (vertex_coordinates[edge.from] && !vertex_coordinates[edge.to]) {
+                vertex_coordinates[edge.to] = vertex_coordinates[edge.from];
+            } else if (vertex_coordinates[edge.to] && !vertex_coordinates[edge.from]) {
+                vertex_coordinates[edge.from] = vertex_coordinates[edge.to];
+            }
+        }
+
+        double road_to_geo_ratio = std::numeric_limits<double>::infinity();
+        const auto update_ratio = [this, &road_to_geo_ratio](StopId from, StopId to) {
+            const double geo_distance = geo::ComputeDistance(tc_.GetStop(from).coords, tc_.GetStop(to).coords);
+            if (geo_distance > 0.0) {
+                road_to_geo_ratio = std::min(road_to_geo_ratio, tc_.GetDistance(from, to) / geo_distance);
+            }
+        };
+        for (BusId bus_id = 0; bus_id < tc_.GetBusCount(); ++bus_id) {
+            const BusRoute& bus = tc_.GetBus(bus_id);
+            for (size_t i = 1; i < bus.stop_ids.size(); ++i) {
+                update_ratio(bus.stop_ids[i - 1], bus.stop_ids[i]);
+                if (!bus.is_circular_route) {
+                    update_ratio(bus.stop_ids[i], bus.stop_ids[i - 1]);
+                }
+            }
+        }
+        double meters_to_minutes_multiplier = std::isinf(road_to_geo_ratio) ? 0.0 : road_to_geo_ratio * GetMetersToMinutesMultiplier();
+        const double bus_wait_time = static_cast<double>(routing_settings_.bus_wait_time);
+        const bool has_walks = std::any_of(edge_infos_.begin(), edge_infos_.end(), [](const EdgeInfo& edge_info) {
+            return edge_info.kind == EdgeKind::Walk;
+        });
+        const double walking_meters_to_minutes_multiplier = has_walks ? GetWalkingMetersToMinutesMultiplier() : std::numeric_limits<double>::infinity();
+        meters_to_minutes_multiplier = std::min(meters_to_minutes_multiplier, walking_meters_to_minutes_multiplier);
 
-        const auto stop_names = tc_.GetStopList();
-        const auto bus_names = tc_.GetBusList();
-        graph_.SetVertexCount(stop_names.size() * 2);
-
-        const double meters_to_minutes_multiplier = 1.0 / METERS_IN_KILOMETER / routing_settings_.bus_velocity * SECONDS_IN_MINUTE;
-        
-        auto update_stopname_to_vertex_id_pair {
-            [this](const std::string& stop_name, graph::VertexId & id) {
-                stopname_to_vertex_id_pair_[stop_name] = { id, id + 1 };
-                id += 2;
-            } 
+        return [vertex_coordinates = std::move(vertex_coordinates), is_wait_vertex = std::move(is_wait_vertex),
+                meters_to_minutes_multiplier, walking_meters_to_minutes_multiplier, bus_wait_time](graph::VertexId vertex, graph::VertexId target) {
+            const auto& from = vertex_coordinates[vertex];
+            const auto& to = vertex_coordinates[target];
+            if (!from || !to) {
+                return 0.0;
+            }
+            const double distance = geo::ComputeDistance(*from, *to);
+            if (!(distance > 0.0)) {
+                return 0.0;
+            }
+            if (!is_wait_vertex[vertex]) {
+                return distance * meters_to_minutes_multiplier;
+            }
+            return std::min(distance * meters_to_minutes_multiplier + bus_wait_time, distance * walking_meters_to_minutes_multiplier);
         };
+    }
+
+    // Travel times of the segments of the unrolled route: times[i] leads from stop i - 1 to stop i, times[0] is zero
+    std::vector<double> TransportRouter::ComputeSegmentTimes(BusId bus_id) const {
+        const double meters_to_minutes_multiplier = GetMetersToMinutesMultiplier();
+        const auto distances = tc_.GetSnapshot().GetSegmentDistances(bus_id);
 
+        std::vector<double> times;
+        times.reserve(distances.end() - distances.begin() + 1);
+        times.push_back(0.0);
+        for (const double distance : distances) {
+            times.push_back(distance * meters_to_minutes_multiplier);
+        }
+        return times;
+    }
+
+    TransportRouter::BusEdges TransportRouter::MakeStopPairsBusEdges(BusId bus_id, const std::vector<StopItemPair>& stop_vertices) const {
         auto abs_of_size_t_diff {[](auto a, auto b) { return (a > b) ? a - b : b - a; } };
 
-        graph::VertexId id = 0;
-        for (const auto& bus_num : bus_names) {
-            const Bus* bus_ref = tc_.FindBusRef(bus_num);
-
-            for (const auto& stop_name : bus_ref->stopnames) {
-                if (stopname_to_vertex_id_pair_.count(stop_name) < 1) {
-                    update_stopname_to_vertex_id_pair(stop_name, id);
-                    graph::EdgeId edge_id = graph_.AddEdge({ 
-                        stopname_to_vertex_id_pair_.at(stop_name).wait_on_stop_id,
-                        stopname_to_vertex_id_pair_.at(stop_name).stop_id,
-                        static_cast<double>(routing_settings_.bus_wait_time)
-                    });
-                    edge_id_to_route_item_[edge_id] = WaitItem{ stop_name, static_cast<double>(routing_settings_.bus_wait_time) }; 
+        const BusRoute& bus = tc_.GetBus(bus_id);
+        const std::vector<double> segment_times = ComputeSegmentTimes(bus_id);
+        size_t stops_count = bus.stop_ids.size();
+        size_t total_stops_count = segment_times.size();
+
+        BusEdges bus_edges;
+        bus_edges.edges.reserve(total_stops_count * (total_stops_count - 1) / 2);
+        bus_edges.edge_infos.reserve(total_stops_count * (total_stops_count - 1) / 2);
+
+        size_t from, to;
+        size_t from_transparent = 0;
+        while (from_transparent < total_stops_count - 1) {
+            size_t to_transparent = from_transparent + 1;
+            from = (from_transparent < stops_count) ? from_transparent : total_stops_count - 1 - from_transparent;
+
+            double time = 0.0;
+            double running_error = 0.0;
+
+            while (to_transparent < total_stops_count) {
+                to = (to_transparent < stops_count) ? to_transparent : total_stops_count - 1 - to_transparent;
+
+                double difference = segment_times[to_transparent] - running_error;
+                double temp = time + difference;
+                running_error = (temp - time) - difference;
+                time = temp;
+
+                bus_edges.edges.push_back({ stop_vertices[from].stop_id, stop_vertices[to].wait_on_stop_id, time });
+                size_t span_count = abs_of_size_t_diff(to, from);
+                bus_edges.edge_infos.push_back({ EdgeKind::Ride, bus_id, static_cast<uint32_t>(span_count) });
+
+                ++to_transparent;
+            }
+            ++from_transparent;
+        }
+        return bus_edges;
+    }
+
+    // Every bus gets its own vertex for each stop of its (unrolled) route, starting from first_bus_vertex_id.
+    // Boarding edges lead from the stop vertex to the bus vertex, ride edges join consecutive bus vertices,
+    // and alighting edges lead back to the wait vertex of the stop. Boarding and alighting edges are
+    // weightless transfer edges, so GetRoute folds a board-ride-...-alight chain into a single BusItem.
+    TransportRouter::BusEdges TransportRouter::MakeBusLinesBusEdges(BusId bus_id, const std::vector<StopItemPair>& stop_vertices,
+                                                                    graph::VertexId first_bus_vertex_id) const {
+        const BusRoute& bus = tc_.GetBus(bus_id);
+        const std::vector<double> segment_times = ComputeSegmentTimes(bus_id);
+        const size_t stops_count = bus.stop_ids.size();
+        const size_t total_stops_count = segment_times.size();
+
+        BusEdges bus_edges;
+        bus_edges.edges.reserve(3 * total_stops_count);
+        bus_edges.edge_infos.reserve(3 * total_stops_count);
+
+        for (size_t transparent = 0; transparent < total_stops_count; ++transparent) {
+            const size_t index = (transparent < stops_count) ? transparent : total_stops_count - 1 - transparent;
+            const graph::VertexId vertex = first_bus_vertex_id + transparent;
+
+            if (transparent > 0) {
+                const double time = segment_times[transparent];
+                bus_edges.edges.push_back({ vertex - 1, vertex, time });
+                bus_edges.edge_infos.push_back({ EdgeKind::Ride, bus_id, 1 });
+
+                bus_edges.edges.push_back({ vertex, stop_vertices[index].wait_on_stop_id, 0.0 });
+                bus_edges.edge_infos.push_back({ EdgeKind::Transfer, 0, 0 });
+            }
+            if (transparent + 1 < total_stops_count) {
+                bus_edges.edges.push_back({ stop_vertices[index].stop_id, vertex, 0.0 });
+                bus_edges.edge_infos.push_back({ EdgeKind::Transfer, 0, 0 });
+            }
+        }
+        return bus_edges;
+    }
+
+    // Vertices are numbered in a sequential pass, bus by bus: stops the graph doesn't know yet get
+    // a wait and a stop vertex from next_stop_vertex_id on, and in the bus_lines model every bus then
+    // gets its own vertices after all the vertices numbered so far. The edges of every bus are made
+    // in parallel, each bus into its own buffer, and appended to the graph in the order of the buses,
+    // after the wait edges of the stops the bus brought in. So edge ids don't depend on the thread count.
+    std::vector<StopId> TransportRouter::AddBusesToGraph(const std::vector<BusId>& bus_ids, graph::VertexId next_stop_vertex_id) {
+        const bool is_bus_lines = routing_settings_.graph_model == GraphModel::BusLines;
+        const double bus_wait_time = static_cast<double>(routing_settings_.bus_wait_time);
+
+        stop_vertices_.resize(tc_.GetStopCount());
+        std::vector<std::vector<StopItemPair>> stop_vertices(bus_ids.size());
+        std::vector<std::vector<StopId>> new_stop_ids(bus_ids.size());
+        std::vector<graph::VertexId> first_bus_vertex_ids(bus_ids.size(), 0);
+        size_t vertex_count = graph_.GetVertexCount();
+        for (size_t i = 0; i < bus_ids.size(); ++i) {
+            const BusRoute& bus = tc_.GetBus(bus_ids[i]);
+            stop_vertices[i].reserve(bus.stop_ids.size());
+            for (const StopId stop_id : bus.stop_ids) {
+                if (!stop_vertices_[stop_id]) {
+                    stop_vertices_[stop_id] = StopItemPair{ next_stop_vertex_id, next_stop_vertex_id + 1 };
+                    new_stop_ids[i].push_back(stop_id);
+                    next_stop_vertex_id += 2;
+                    vertex_count = std::max<size_t>(vertex_count, next_stop_vertex_id);
                 }
+                stop_vertices[i].push_back(*stop_vertices_[stop_id]);
+            }
+            // A bus without stops gets no vertices, a linear one would otherwise take 2 * 0 - 1 of them
+            if (is_bus_lines && !bus.stop_ids.empty()) {
+                first_bus_vertex_ids[i] = vertex_count;
+                vertex_count += (bus.is_circular_route) ? bus.stop_ids.size() : 2 * bus.stop_ids.size() - 1;
+            }
+        }
+        graph_.SetVertexCount(vertex_count);
+
+        std::vector<BusEdges> bus_edges(bus_ids.size());
+        parallel::ThreadPool thread_pool(std::min(parallel::GetDefaultThreadCount(), bus_ids.size()));
+        thread_pool.ParallelFor(bus_ids.size(), [&](size_t i) {
+            bus_edges[i] = is_bus_lines ? MakeBusLinesBusEdges(bus_ids[i], stop_vertices[i], first_bus_vertex_ids[i])
+                                        : MakeStopPairsBusEdges(bus_ids[i], stop_vertices[i]);
+        });
+
+        std::vector<StopId> all_new_stop_ids;
+        for (size_t i = 0; i < bus_ids.size(); ++i) {
+            for (const StopId stop_id : new_stop_ids[i]) {
+                const StopItemPair& vertices = *stop_vertices_[stop_id];
+                graph_.AddEdge({ vertices.wait_on_stop_id, vertices.stop_id, bus_wait_time });
+                edge_infos_.push_back({ EdgeKind::Wait, stop_id, 0 });
+                all_new_stop_ids.push_back(stop_id);
+            }
+            for (const auto& edge : bus_edges[i].edges) {
+                graph_.AddEdge(edge);
+            }
+            edge_infos_.insert(edge_infos_.end(), bus_edges[i].edge_infos.begin(), bus_edges[i].edge_infos.end());
+            bus_edges[i] = BusEdges{};
+        }
+        return all_new_stop_ids;
+    }
+
+    void TransportRouter::AddWalkEdge(StopId from, StopId to, double distance) {
+        graph_.AddEdge({ stop_vertices_[from]->wait_on_stop_id, stop_vertices_[to]->wait_on_stop_id,
+                         distance * GetWalkingMetersToMinutesMultiplier() });
+        edge_infos_.push_back({ EdgeKind::Walk, to, 0 });
+    }
+
+    // A walk leads from the wait vertex of a stop, where a ride ends, to the wait vertex of the other stop,
+    // so the next boarding waits for the bus as usual. The pairs come from a self-join over the spatial grid
+    // of the catalogue, so only nearby stops are ever compared.
+    void TransportRouter::AddWalkingTransferEdges() {
+        if (!(routing_settings_.walking_transfer_radius > 0.0)) {
+            return;
+        }
+        if (!(routing_settings_.walking_velocity > 0.0)) {
+            throw std::invalid_argument("walking velocity should be positive"s);
+        }
+        for (const auto& [from, to, distance] : tc_.GetSnapshot().GetSpatialGrid().FindStopPairsInRadius(routing_settings_.walking_transfer_radius)) {
+            if (stop_vertices_[from] && stop_vertices_[to]) {
+                AddWalkEdge(from, to, distance);
+                AddWalkEdge(to, from, distance);
             }
+        }
+    }
 
-            size_t stops_count = bus_ref->stopnames.size();
-            size_t total_stops_count = (bus_ref->is_circular_route) ? stops_count : 2 * stops_count - 1;
-
-            size_t from, to, prev_to;
-            size_t from_transparent = 0;
-            while (from_transparent < total_stops_count - 1) {
-                size_t to_transparent = from_transparent + 1;
-                from = (from_transparent < stops_count) ? from_transparent : total_stops_count - 1 - from_transparent;
-
-                double time = 0.0;
-                double running_error = 0.0;
-
-                while (to_transparent < total_stops_count) {
-                    to = (to_transparent < stops_count) ? to_transparent : total_stops_count - 1 - to_transparent;
-                    prev_to = (to_transparent < stops_count) ? to - 1 : to + 1;
-
-                    double difference = (tc_.GetDistance(bus_ref->stopnames[prev_to], bus_ref->stopnames[to]) * meters_to_minutes_multiplier) - running_error;
-                    double temp = time + difference;
-                    running_error = (temp - time) - difference;
-                    time = temp;
-                    
-                    graph::EdgeId edge_id = graph_.AddEdge({ 
-                        stopname_to_vertex_id_pair_.at(bus_ref->stopnames[from]).stop_id,
-                        stopname_to_vertex_id_pair_.at(bus_ref->stopnames[to]).wait_on_stop_id,
-                        time
-                    });
-                    size_t span_count = abs_of_size_t_diff(to, from);
-                    edge_id_to_route_item_[edge_id] = BusItem{ bus_ref->num, span_count, time };
-
-                    ++to_transparent;
+    // Walks between two new stops are added by the later of them
+    void TransportRouter::AddWalkingTransferEdges(const std::vector<StopId>& new_stop_ids) {
+        if (!(routing_settings_.walking_transfer_radius > 0.0)) {
+            return;
+        }
+        const CatalogueSnapshot& snapshot = tc_.GetSnapshot();
+        std::vector<bool> is_added(stop_vertices_.size(), false);
+        for (const StopId stop_id : new_stop_ids) {
+            const auto nearby_stops = snapshot.GetSpatialGrid().FindStopsInRadius(snapshot.GetStopCoordinates(stop_id),
+                                                                                  routing_settings_.walking_transfer_radius);
+            for (const auto& [other_stop_id, distance] : nearby_stops) {
+                if (other_stop_id == stop_id || !stop_vertices_[other_stop_id]) {
+                    continue;
+                }
+                const bool is_new = std::find(new_stop_ids.begin(), new_stop_ids.end(), other_stop_id) != new_stop_ids.end();
+                if (!is_new || is_added[other_stop_id]) {
+                    AddWalkEdge(stop_id, other_stop_id, distance);
+                    AddWalkEdge(other_stop_id, stop_id, distance);
                 }
-                ++from_transparent;
             }
+            is_added[stop_id] = true;
+        }
+    }
+
+    // Stops the graph doesn't know yet get their vertices after all the existing ones. The all-pairs
+    // table is then repaired through the new edges only; the other engines are rebuilt, which for
+    // the per-query searches costs next to nothing.
+    void TransportRouter::AddBus(std::string_view bus_num) {
+        const BusId bus_id = tc_.GetBusId(bus_num);
+        if (routing_settings_.router_engine != RouterEngine::Raptor) {
+            AddWalkingTransferEdges(AddBusesToGraph({ bus_id }, graph_.GetVertexCount()));
+        }
+        endpoints_router_.reset();
+
+        if (auto* router = std::get_if<graph::Router<double>>(&router_)) {
+            router->UpdateWithNewEdges();
+        } else {
+            landmarks_.reset();
+            UpdateRouter();
         }
-        router_.Update();
     }
 
     RouteInfo TransportRouter::GetRoute(std::tuple<std::string_view,std::string_view> from_to) {
-        if (stopname_to_vertex_id_pair_.count(std::get<0>(from_to)) < 1 || stopname_to_vertex_id_pair_.count(std::get<1>(from_to)) < 1) {
+        const CatalogueSnapshot& snapshot = tc_.GetSnapshot();
+        const StopId from_stop_id = snapshot.GetStopId(std::get<0>(from_to));
+        const StopId to_stop_id = snapshot.GetStopId(std::get<1>(from_to));
+
+        if (const auto* raptor = std::get_if<RaptorRouter>(&router_)) {
+            auto route_info = raptor->BuildRoute(from_stop_id, to_stop_id);
+            if (!route_info) {
+                throw std::out_of_range("not found"s);
+            }
+            return std::move(*route_info);
+        }
+
+        if (from_stop_id >= stop_vertices_.size() || !stop_vertices_[from_stop_id]
+            || to_stop_id >= stop_vertices_.size() || !stop_vertices_[to_stop_id]) {
             throw std::out_of_range("not found"s);
         }
 
-        graph::VertexId from = stopname_to_vertex_id_pair_[std::get<0>(from_to)].wait_on_stop_id;
-        graph::VertexId to = stopname_to_vertex_id_pair_[std::get<1>(from_to)].wait_on_stop_id;
-        const auto raw_route_info = router_.BuildRoute(from, to);
+        graph::VertexId from = stop_vertices_[from_stop_id]->wait_on_stop_id;
+        graph::VertexId to = stop_vertices_[to_stop_id]->wait_on_stop_id;
+        const auto raw_route_info = BuildRoute(from, to);
+        if (!raw_route_info) {
+            throw std::out_of_range("not found"s);
+        }
 
-        RouteInfo route_info;
-        if (raw_route_info.has_value()) {
-            route_info.total_time = raw_route_info.value().weight;
+        return RouteInfo{ raw_route_info->weight, MakeRouteItems(raw_route_info->edges) };
+    }
+
+    bool TransportRouter::HasStopVertices(StopId stop_id) const {
+        if (const auto* raptor = std::get_if<RaptorRouter>(&router_)) {
+            return raptor->HasStop(stop_id);
+        }
+        return stop_id < stop_vertices_.size() && stop_vertices_[stop_id];
+    }
+
+    // Bus items are folded from the ride edges of a bus, in the bus_lines model from the whole
+    // chain between a boarding and an alighting transfer edge
+    std::vector<RouteItem> TransportRouter::MakeRouteItems(const std::vector<graph::EdgeId>& edges) const {
+        const CatalogueSnapshot& snapshot = tc_.GetSnapshot();
 
-            route_info.items.reserve(raw_route_info.value().edges.size());
-            for (graph::EdgeId edge_id : raw_route_info.value().edges) {
-                route_info.items.emplace_back(edge_id_to_route_item_.at(edge_id));         
+        std::vector<RouteItem> items;
+        items.reserve(edges.size());
+        std::optional<BusItem> boarded_bus;
+        for (graph::EdgeId edge_id : edges) {
+            const EdgeInfo& edge_info = edge_infos_.at(edge_id);
+            const double time = graph_.GetEdge(edge_id).weight;
+            if (edge_info.kind == EdgeKind::Transfer) {
+                if (boarded_bus) {
+                    items.emplace_back(std::move(*boarded_bus));
+                    boarded_bus.reset();
+                } else {
+                    boarded_bus = BusItem{ {}, 0, 0.0 };
+                }
+            } else if (edge_info.kind == EdgeKind::Wait) {
+                items.emplace_back(WaitItem{ std::string(snapshot.GetStopName(edge_info.name_id)), time });
+            } else if (edge_info.kind == EdgeKind::Walk) {
+                items.emplace_back(WalkItem{ std::string(snapshot.GetStopName(edge_info.name_id)), time / GetWalkingMetersToMinutesMultiplier(), time });
+            } else if (boarded_bus) {
+                if (boarded_bus->bus.empty()) {
+                    boarded_bus->bus = snapshot.GetBusName(edge_info.name_id);
+                }
+                boarded_bus->span_count += edge_info.span_count;
+                boarded_bus->time += time;
+            } else {
+                items.emplace_back(BusItem{ std::string(snapshot.GetBusName(edge_info.name_id)), edge_info.span_count, time });
             }
-        } else {
-            throw std::out_of_range("not found"s);
+        }
+        return items;
+    }
+
+    // RAPTOR seeds its rounds with the offsets itself; on the graph the search starts from the wait vertices
+    // of the stops, so the journey goes the same way as the one between the stops
+    std::optional<RaptorRouter::EndpointsRoute> TransportRouter::BuildEndpointsRoute(const std::vector<RaptorRouter::StopOffset>& sources,
+                                                                                     const std::vector<RaptorRouter::StopOffset>& targets) {
+        if (const auto* raptor = std::get_if<RaptorRouter>(&router_)) {
+            return raptor->BuildRoute(sources, targets);
         }
 
+        if (!endpoints_router_) {
+            endpoints_router_.emplace(graph_);
+        }
+        const auto to_endpoints = [this](const std::vector<RaptorRouter::StopOffset>& stops) {
+            std::vector<graph::DijkstraRouter<double>::Endpoint> endpoints;
+            endpoints.reserve(stops.size());
+            for (const auto& [stop_id, time] : stops) {
+                endpoints.push_back({ stop_vertices_[stop_id]->wait_on_stop_id, time });
+            }
+            return endpoints;
+        };
+        const auto raw_route_info = endpoints_router_->BuildRoute(to_endpoints(sources), to_endpoints(targets));
+        if (!raw_route_info) {
+            return std::nullopt;
+        }
+
+        const auto find_stop = [this](const std::vector<RaptorRouter::StopOffset>& stops, graph::VertexId vertex) {
+            return std::find_if(stops.begin(), stops.end(), [this, vertex](const RaptorRouter::StopOffset& stop) {
+                return stop_vertices_[stop.stop]->wait_on_stop_id == vertex;
+            })->stop;
+        };
+        return RaptorRouter::EndpointsRoute{ RouteInfo{ raw_route_info->weight, MakeRouteItems(raw_route_info->edges) },
+                                             find_stop(sources, raw_route_info->source), find_stop(targets, raw_route_info->target) };
+    }
+
+    RouteInfo TransportRouter::GetRoute(geo::Coordinates from, geo::Coordinates to) {
+        if (!(routing_settings_.walking_velocity > 0.0)) {
+            throw std::invalid_argument("walking velocity should be positive"s);
+        }
+        const CatalogueSnapshot& snapshot = tc_.GetSnapshot();
+        const double meters_to_minutes_multiplier = GetWalkingMetersToMinutesMultiplier();
+
+        RouteInfo route_info{ 0.0, {} };
+        const double direct_distance = geo::ComputeDistance(from, to);
+        if (std::isnan(direct_distance)) {
+            throw std::invalid_argument("invalid coordinates"s);
+        }
+        if (direct_distance > 0.0) {
+            route_info.total_time = direct_distance * meters_to_minutes_multiplier;
+            route_info.items.emplace_back(WalkItem{ {}, direct_distance, route_info.total_time });
+        }
+
+        std::unordered_map<StopId, double> source_distances;
+        std::unordered_map<StopId, double> target_distances;
+        const auto find_stops = [&](geo::Coordinates point, std::unordered_map<StopId, double>& distances) {
+            std::vector<RaptorRouter::StopOffset> stops;
+            for (const auto& [stop_id, distance] : snapshot.GetSpatialGrid().FindStopsInRadius(point, routing_settings_.walking_radius)) {
+                if (HasStopVertices(stop_id)) {
+                    stops.push_back({ stop_id, distance * meters_to_minutes_multiplier });
+                    distances[stop_id] = distance;
+                }
+            }
+            return stops;
+        };
+        const std::vector<RaptorRouter::StopOffset> sources = find_stops(from, source_distances);
+        const std::vector<RaptorRouter::StopOffset> targets = find_stops(to, target_distances);
+        if (sources.empty() || targets.empty()) {
+            return route_info;
+        }
+
+        auto endpoints_route = BuildEndpointsRoute(sources, targets);
+        if (!endpoints_route || !(endpoints_route->route.total_time < route_info.total_time)) {
+            return route_info;
+        }
+
+        const auto make_walk_item = [&](StopId stop_id, double distance) {
+            return WalkItem{ std::string(snapshot.GetStopName(stop_id)), distance, distance * meters_to_minutes_multiplier };
+        };
+        route_info.total_time = endpoints_route->route.total_time;
+        route_info.items.clear();
+        if (const double distance = source_distances.at(endpoints_route->source); distance > 0.0) {
+            route_info.items.emplace_back(make_walk_item(endpoints_route->source, distance));
+        }
+        std::move(endpoints_route->route.items.begin(), endpoints_route->route.items.end(), std::back_inserter(route_info.items));
+        if (const double distance = target_distances.at(endpoints_route->target); distance > 0.0) {
+            route_info.items.emplace_back(make_walk_item(endpoints_route->target, distance));
+        }
         return route_info;
     }
-}
\ No newline at end of file
+}
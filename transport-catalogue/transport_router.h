@@ -1,17 +1,27 @@
 #pragma once
 
 #include <map>
+#include <optional>
 #include <string>
+#include <variant>
+#include <vector>
 
 #include "domain.h"
 #include "router.h"
+#include "dijkstra_router.h"
+#include "bidirectional_dijkstra_router.h"
+#include "contraction_hierarchy.h"
+#include "landmarks.h"
+#include "hub_labels.h"
+#include "raptor_router.h"
+#include "thread_pool.h"
 #include "transport_catalogue.h"
 
 namespace transport_catalogue {
 class TransportRouter {
 public:
     explicit TransportRouter(const TransportCatalogue& db) 
-        : tc_(db), graph_(graph::DirectedWeightedGraph<double>(0)), router_(graph::Router<double>(graph_)) { }
+        : tc_(db), graph_(graph::DirectedWeightedGraph<double>(0)) { }
 
     struct StopItemPair { 
         graph::VertexId wait_on_stop_id;
@@ -19,32 +29,95 @@ public:
     };
 
     void SetUp(const RoutingSettings& routing_settings);
+    // Extends the graph and the router set up earlier with a bus added to the catalogue since
+    void AddBus(std::string_view bus_num);
 
     void SetRoutingSettings(const RoutingSettings& routing_settings);
     const RoutingSettings GetRoutingSettings() const;
     
     RouteInfo GetRoute(std::tuple<std::string_view,std::string_view> from_to);
+    // Route between two points: a walk to one of the stops within the walking radius of the start, the rides
+    // and a walk from a stop within the radius of the end, or a walk all the way if that is faster.
+    // All the stops near both points are searched from at once.
+    RouteInfo GetRoute(geo::Coordinates from, geo::Coordinates to);
 
     const graph::DirectedWeightedGraph<double>& GetGraph() const;
     graph::DirectedWeightedGraph<double>& GetGraph();
 
-    void SetStopnameToVertexIdPair(const std::map<std::string, StopItemPair>& stopname_to_vertex_id_pair);
-    const std::map<std::string_view, StopItemPair>& GetStopNameToVertexIdPair() const;
+    // Vertices of every stop by StopId, empty for the stops no bus goes through
+    void SetStopVertices(std::vector<std::optional<StopItemPair>> stop_vertices);
+    const std::vector<std::optional<StopItemPair>>& GetStopVertices() const;
 
-    void SetEdgeIdToRouteItem(const std::map<graph::VertexId, RouteItem>& edge_id_to_route_item);
-    const std::map<graph::VertexId, RouteItem>& GetEdgeIdToRouteItem() const;
+    // What an edge of the graph stands for in a route. The edge weight is the time of the item.
+    // Transfer edges (boarding and alighting in the bus_lines model) map to std::monostate.
+    // Walk edges join the wait vertices of stops within the walking transfer radius of each other.
+    enum class EdgeKind : uint8_t { Transfer, Wait, Ride, Walk };
+
+    struct EdgeInfo {
+        EdgeKind kind;
+        uint32_t name_id;  // StopId for Wait and Walk (the stop walked to), BusId for Ride
+        uint32_t span_count;
+    };
+
+    const std::vector<EdgeInfo>& GetEdgeInfos() const;
+    void SetEdgeInfos(std::vector<EdgeInfo> edge_infos);
 
     void UpdateRouter();
 
+    const graph::Router<double>::RoutesStorage* GetRoutesInternalData() const;
+    void SetRoutesInternalData(graph::Router<double>::RoutesStorage routes_internal_data);
+
+    const graph::ContractionHierarchy<double>* GetContractionHierarchy() const;
+    void SetContractionHierarchy(std::vector<uint32_t> ranks, std::vector<graph::ContractionHierarchy<double>::Shortcut> shortcuts);
+
+    const graph::HubLabels<double>* GetHubLabels() const;
+    void SetHubLabels(std::vector<graph::VertexId> vertices_by_rank, graph::HubLabels<double>::LabelSet outgoing_labels,
+                      graph::HubLabels<double>::LabelSet incoming_labels);
+
+    const graph::Landmarks<double>* GetLandmarks() const;
+    void SetLandmarks(std::vector<graph::VertexId> landmarks, std::vector<double> weights_from_landmarks, std::vector<double> weights_to_landmarks);
+
 private:
+    using RouterVariant = std::variant<std::monostate, graph::Router<double>, graph::DijkstraRouter<double>, graph::BidirectionalDijkstraRouter<double>,
+        graph::ContractionHierarchy<double>, graph::HubLabels<double>, RaptorRouter>;
+
     RoutingSettings routing_settings_;
 
     const TransportCatalogue& tc_;
     graph::DirectedWeightedGraph<double> graph_;
-    graph::Router<double> router_;
+    RouterVariant router_;
+    std::optional<graph::Landmarks<double>> landmarks_;
+    // Plain Dijkstra over the graph for the routes between points, whatever the engine; made on the first such route
+    std::optional<graph::DijkstraRouter<double>> endpoints_router_;
+
+    std::vector<std::optional<StopItemPair>> stop_vertices_;  // indexed by StopId
+    std::vector<EdgeInfo> edge_infos_;  // indexed by edge id
+
+    std::optional<graph::RouteInfo<double>> BuildRoute(graph::VertexId from, graph::VertexId to) const;
+    // Offsets of the stops are the walking times to them or from them
+    std::optional<RaptorRouter::EndpointsRoute> BuildEndpointsRoute(const std::vector<RaptorRouter::StopOffset>& sources,
+                                                                    const std::vector<RaptorRouter::StopOffset>& targets);
+    bool HasStopVertices(StopId stop_id) const;
+    std::vector<RouteItem> MakeRouteItems(const std::vector<graph::EdgeId>& edges) const;
+
+    double GetMetersToMinutesMultiplier() const;
+    double GetWalkingMetersToMinutesMultiplier() const;
+    graph::DijkstraRouter<double>::Heuristic MakeGeoHeuristic() const;
+
+    // Edges of one bus and their infos, made independently of the other buses
+    struct BusEdges {
+        std::vector<graph::Edge<double>> edges;
+        std::vector<EdgeInfo> edge_infos;
+    };
 
-    std::map<std::string_view, StopItemPair> stopname_to_vertex_id_pair_;
-    std::map<graph::VertexId, RouteItem> edge_id_to_route_item_;
+    std::vector<double> ComputeSegmentTimes(BusId bus_id) const;
+    BusEdges MakeStopPairsBusEdges(BusId bus_id, const std::vector<StopItemPair>& stop_vertices) const;
+    BusEdges MakeBusLinesBusEdges(BusId bus_id, const std::vector<StopItemPair>& stop_vertices, graph::VertexId first_bus_vertex_id) const;
+    // Returns the stops that got their vertices
+    std::vector<StopId> AddBusesToGraph(const std::vector<BusId>& bus_ids, graph::VertexId next_stop_vertex_id);
+    void AddWalkingTransferEdges();
+    void AddWalkingTransferEdges(const std::vector<StopId>& new_stop_ids);
+    void AddWalkEdge(StopId from, StopId to, double distance);
 };
 }
 